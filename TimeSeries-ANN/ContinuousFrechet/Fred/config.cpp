@@ -8,10 +8,23 @@ The above copyright notice and this permission notice shall be included in all c
 THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "config.hpp"
+
 namespace Config {
         
     unsigned int verbosity = 0;
     bool mp_dynamic = true;
     int number_threads = -1;
     
+    void apply() {
+#ifdef _OPENMP
+        omp_set_dynamic(mp_dynamic);
+        if (number_threads > 0) omp_set_num_threads(number_threads);
+#endif
+    }
+    
 }
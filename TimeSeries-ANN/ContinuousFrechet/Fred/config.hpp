@@ -18,4 +18,8 @@ namespace Config {
     extern bool mp_dynamic;
     extern int number_threads;
     
+    // hands number_threads (if positive) and mp_dynamic over to OpenMP, call it after changing them
+    // (does nothing when built without OpenMP, see "make omp")
+    void apply();
+    
 }
@@ -28,7 +28,31 @@ std::string Distance::repr() const {
     return ss.str();
 }
 
-Distance distance(const Curve &curve1, const Curve &curve2) {
+void Workspace::prepare(const curve_size_t n1, const curve_size_t n2) {
+    const std::size_t cells = n1 * n2;
+    this->n1 = n1;
+    this->n2 = n2;
+    if (cells1.size() < cells) {
+        cells1.resize(cells);
+        cells2.resize(cells);
+    }
+    if (border1.size() < n1) border1.resize(n1);
+    if (border2.size() < n2) border2.resize(n2);
+    if (rows.size() < 4 * n2) rows.resize(4 * n2);
+}
+
+Workspace& thread_workspace() {
+    static thread_local Workspace workspace;
+    return workspace;
+}
+
+template <typename Curve_T>
+Distance distance(const Curve_T &curve1, const Curve_T &curve2) {
+    return distance(curve1, curve2, thread_workspace());
+}
+
+template <typename Curve_T>
+Distance distance(const Curve_T &curve1, const Curve_T &curve2, Workspace &workspace) {
     if ((curve1.complexity() < 2) || (curve2.complexity() < 2)) {
         std::cerr << "WARNING: comparison possible only for curves of at least two points" << std::endl;
         Distance result;
@@ -49,13 +73,39 @@ Distance distance(const Curve &curve1, const Curve &curve2) {
     const distance_t ub = _greedy_upper_bound(curve1, curve2);
     const auto end = std::clock();
     
-    auto dist = _distance(curve1, curve2, ub, lb);
+    auto dist = _distance(curve1, curve2, ub, lb, workspace);
     dist.time_bounds = (end - start) / CLOCKS_PER_SEC;
 
     return dist;
 }
 
-Distance _distance(const Curve &curve1, const Curve &curve2, distance_t ub, distance_t lb) {
+template <typename Curve_T>
+bool less_than(const Curve_T &curve1, const Curve_T &curve2, const distance_t eps) {
+    return less_than(curve1, curve2, eps, thread_workspace());
+}
+
+template <typename Curve_T>
+bool less_than(const Curve_T &curve1, const Curve_T &curve2, const distance_t eps, Workspace &workspace) {
+    if ((curve1.complexity() < 2) || (curve2.complexity() < 2) || (curve1.dimensions() != curve2.dimensions())) {
+        std::cerr << "WARNING: comparison possible only for curves of at least two points and of equal number of dimensions" << std::endl;
+        return false;
+    }
+    
+    if (_projective_lower_bound(curve1, curve2, eps) >= eps) return false;
+    
+    // the greedy traversal is a valid one, so its width is an upper bound
+    if (_greedy_upper_bound(curve1, curve2) < eps) return true;
+    
+    return _less_than_or_equal(eps, curve1, curve2, workspace);
+}
+
+template <typename Curve_T>
+Distance _distance(const Curve_T &curve1, const Curve_T &curve2, distance_t ub, distance_t lb) {
+    return _distance(curve1, curve2, ub, lb, thread_workspace());
+}
+
+template <typename Curve_T>
+Distance _distance(const Curve_T &curve1, const Curve_T &curve2, distance_t ub, distance_t lb, Workspace &workspace) {
     Distance result;
     const auto start = std::clock();
     
@@ -65,25 +115,21 @@ Distance _distance(const Curve &curve1, const Curve &curve2, distance_t ub, dist
     
     if (ub - lb > p_error) {
         if (Config::verbosity > 2) std::cout << "CFD: binary search using FSD" << std::endl;
-        
-        const auto infty = std::numeric_limits<parameter_t>::infinity();
-        std::vector<Parameters> reachable1(curve1.complexity() - 1, Parameters(curve2.complexity(), infty));
-        std::vector<Parameters> reachable2(curve1.complexity(), Parameters(curve2.complexity() - 1, infty));
-        
-        std::vector<Intervals> free_intervals1(curve2.complexity(), Intervals(curve1.complexity(), Interval()));
-        std::vector<Intervals> free_intervals2(curve1.complexity(), Intervals(curve2.complexity(), Interval()));
 
         if (std::isnan(lb) || std::isnan(ub)) {
             result.value = std::numeric_limits<distance_t>::signaling_NaN();
             return result;
         }
+        
+        // the cells do not depend on the distance, so all decisions below share them
+        _free_space_cells(curve1, curve2, workspace);
 
         //Binary search over the feasible distances
         while (ub - lb > p_error) {
             ++number_searches;
             split = (ub + lb)/distance_t(2);
             if (split == lb || split == ub) break;
-            auto isLessThan = _less_than_or_equal(split, curve1, curve2, reachable1, reachable2, free_intervals1, free_intervals2);
+            auto isLessThan = _reachable(split, workspace);
             if (isLessThan) {
                 ub = split;
             }
@@ -101,84 +147,116 @@ Distance _distance(const Curve &curve1, const Curve &curve2, distance_t ub, dist
     return result;
 }
 
-bool _less_than_or_equal(const distance_t distance, Curve const& curve1, Curve const& curve2, 
-        std::vector<Parameters> &reachable1, std::vector<Parameters> &reachable2,
-        std::vector<Intervals> &free_intervals1, std::vector<Intervals> &free_intervals2) {
-    
-    if (Config::verbosity > 2) std::cout << "CFD: constructing FSD" << std::endl;
-    const distance_t dist_sqr = distance * distance;
-    const auto infty = std::numeric_limits<parameter_t>::infinity();
+template <typename Curve_T>
+bool _less_than_or_equal(const distance_t distance, Curve_T const& curve1, Curve_T const& curve2, Workspace &workspace) {
+    _free_space_cells(curve1, curve2, workspace);
+    return _reachable(distance, workspace);
+}
+
+template <typename Curve_T>
+void _free_space_cells(const Curve_T &curve1, const Curve_T &curve2, Workspace &workspace) {
+    if (Config::verbosity > 2) std::cout << "CFD: computing FSD cells" << std::endl;
     const curve_size_t n1 = curve1.complexity();
     const curve_size_t n2 = curve2.complexity();
-
-    if (Config::verbosity > 2) std::cout << "CFD: resetting old FSD" << std::endl;
     
-    #pragma omp parallel for collapse(2) if (n1 * n2 > 1000)
-    for (curve_size_t i = 0; i < n1; ++i) {
-        for (curve_size_t j = 0; j < n2; ++j) {
-            if (i < n1 - 1) reachable1[i][j] = infty;
-            if (j < n2 - 1) reachable2[i][j] = infty;
-            free_intervals1[j][i].reset();
-            free_intervals2[i][j].reset();
+    workspace.prepare(n1, n2);
+    
+    // the segment from start to end and the point
+    auto cell = [](const decltype(curve1[0]) &start, const decltype(curve1[0]) &end, const decltype(curve1[0]) &point) {
+        Workspace::Cell result;
+        const auto u = end - start, v = point - start;
+        const distance_t ulen_sqr = u.length_sqr(), vlen_sqr = v.length_sqr();
+        if (ulen_sqr == 0) {
+            result.center = 0;
+            result.height_sqr = vlen_sqr;
+            result.inv_length_sqr = 0;
+        } else {
+            const distance_t uv = u * v;
+            result.center = uv / ulen_sqr;
+            result.height_sqr = vlen_sqr - uv * result.center;
+            result.inv_length_sqr = 1 / ulen_sqr;
         }
-    }
-    
-    if (Config::verbosity > 2) std::cout << "CFD: FSD borders" << std::endl;
-    
-    for (curve_size_t i = 0; i < n1 - 1; ++i) {
-        reachable1[i][0] = 0;
-        if (curve2[0].dist_sqr(curve1[i+1]) > dist_sqr) break;
-    }
-    
-    for (curve_size_t j = 0; j < n2 - 1; ++j) {
-        reachable2[0][j] = 0;
-        if (curve1[0].dist_sqr(curve2[j+1]) > dist_sqr) break;
-    }
-    
-    if (Config::verbosity > 2) std::cout << "CFD: computing free space" << std::endl;
+        return result;
+    };
     
-    #pragma omp parallel for collapse(2) if (n1 * n2 > 1000)
     for (curve_size_t i = 0; i < n1; ++i) {
         for (curve_size_t j = 0; j < n2; ++j) {
-            if ((i < n1 - 1) && (j > 0)) {
-                free_intervals1[j][i] = curve2[j].ball_intersection_interval(dist_sqr, curve1[i], curve1[i+1]);
-            }
-            if ((j < n2 - 1) && (i > 0)) {
-                free_intervals2[i][j] = curve1[i].ball_intersection_interval(dist_sqr, curve2[j], curve2[j+1]);
-            }
+            if ((i < n1 - 1) && (j > 0)) workspace.cell1(i, j) = cell(curve1[i], curve1[i+1], curve2[j]);
+            if ((j < n2 - 1) && (i > 0)) workspace.cell2(i, j) = cell(curve2[j], curve2[j+1], curve1[i]);
         }
     }
     
+    for (curve_size_t i = 0; i < n1 - 1; ++i) workspace.border1[i] = curve2[0].dist_sqr(curve1[i+1]);
+    for (curve_size_t j = 0; j < n2 - 1; ++j) workspace.border2[j] = curve1[0].dist_sqr(curve2[j+1]);
+}
+
+bool _reachable(const distance_t distance, Workspace &workspace) {
     if (Config::verbosity > 2) std::cout << "CFD: computing reachable space" << std::endl;
+    const distance_t dist_sqr = distance * distance;
+    const auto infty = std::numeric_limits<parameter_t>::infinity();
+    const curve_size_t n1 = workspace.n1;
+    const curve_size_t n2 = workspace.n2;
     
-    for (curve_size_t i = 0; i < n1; ++i) {
+    // reachable parts of row i - 1 (prev) and row i (curr): reachable1 is for segment [i, i+1] of curve1 against vertex j of
+    // curve2, reachable2 for vertex i of curve1 against segment [j, j+1] of curve2
+    parameter_t *prev1 = workspace.rows.data(), *prev2 = prev1 + n2, *curr1 = prev2 + n2, *curr2 = curr1 + n2;
+    
+    bool border1_open = true;
+    // reachable1 of the last row of vertices is never defined, so the answer is known after row n1 - 2
+    for (curve_size_t i = 0; i < n1 - 1; ++i) {
+        std::fill(curr1, curr1 + n2, infty);
+        std::fill(curr2, curr2 + n2, infty);
+        
+        // borders of the diagram
+        if (border1_open) {
+            curr1[0] = 0;
+            border1_open = workspace.border1[i] <= dist_sqr;
+        }
+        if (i == 0) {
+            for (curve_size_t j = 0; j < n2 - 1; ++j) {
+                curr2[j] = 0;
+                if (workspace.border2[j] > dist_sqr) break;
+            }
+        }
+        
+        bool any_reachable = curr1[0] != infty;
         for (curve_size_t j = 0; j < n2; ++j) {
-            if ((i < n1 - 1) && (j > 0)) {
-                if (!free_intervals1[j][i].empty()) {
-                    if (reachable2[i][j-1] != infty) {
-                        reachable1[i][j] = free_intervals1[j][i].begin();
+            if (j > 0) {
+                const Interval free1 = workspace.cell1(i, j).free_interval(dist_sqr);
+                if (!free1.empty()) {
+                    if (curr2[j-1] != infty) {
+                        curr1[j] = free1.begin();
                     }
-                    else if (reachable1[i][j-1] <= free_intervals1[j][i].end()) {
-                        reachable1[i][j] = std::max(free_intervals1[j][i].begin(), reachable1[i][j-1]);
+                    else if (curr1[j-1] <= free1.end()) {
+                        curr1[j] = std::max(free1.begin(), curr1[j-1]);
                     }
                 }
             }
             if ((j < n2 - 1) && (i > 0)) {
-                if (!free_intervals2[i][j].empty()) {
-                    if (reachable1[i-1][j] != infty) {
-                        reachable2[i][j] = free_intervals2[i][j].begin();
+                const Interval free2 = workspace.cell2(i, j).free_interval(dist_sqr);
+                if (!free2.empty()) {
+                    if (prev1[j] != infty) {
+                        curr2[j] = free2.begin();
                     }
-                    else if (reachable2[i-1][j] <= free_intervals2[i][j].end()) {
-                        reachable2[i][j] = std::max(free_intervals2[i][j].begin(), reachable2[i-1][j]);
+                    else if (prev2[j] <= free2.end()) {
+                        curr2[j] = std::max(free2.begin(), prev2[j]);
                     }
                 }
             }
+            any_reachable = any_reachable || curr1[j] != infty || curr2[j] != infty;
         }
+        
+        // nothing of this row can be reached, so nothing after it either
+        if (!any_reachable) return false;
+        
+        std::swap(prev1, curr1);
+        std::swap(prev2, curr2);
     }
-    return reachable1.back().back() < infty;
+    return prev1[n2 - 1] < infty;
 }
 
-distance_t _greedy_upper_bound(const Curve &curve1, const Curve &curve2) {
+template <typename Curve_T>
+distance_t _greedy_upper_bound(const Curve_T &curve1, const Curve_T &curve2) {
     distance_t result = 0;
     
     const curve_size_t len1 = curve1.complexity(), len2 = curve2.complexity();
@@ -208,40 +286,122 @@ distance_t _greedy_upper_bound(const Curve &curve1, const Curve &curve2) {
     return std::sqrt(result);
 }
 
-distance_t _projective_lower_bound(const Curve &curve1, const Curve &curve2) {
-    std::vector<distance_t> distances1_sqr = std::vector<distance_t>(curve2.complexity() - 1), distances2_sqr = std::vector<distance_t>(curve1.complexity() + curve2.complexity() + 2);
+Bound_Statistics bound_statistics;
+
+std::string Bound_Statistics::repr() const {
+    std::stringstream ss;
+    const std::size_t n = calls, pruned = endpoints + bounding_box + sampled + projective;
+    auto rate = [n](const std::size_t k) { return n == 0 ? 0. : 100. * k / n; };
+    ss << "lower bounds: " << n << " calls, pruned by endpoints " << endpoints << " (" << rate(endpoints) << "%)"
+        << ", bounding box " << bounding_box << " (" << rate(bounding_box) << "%)"
+        << ", sampled vertices " << sampled << " (" << rate(sampled) << "%)"
+        << ", projective " << projective << " (" << rate(projective) << "%)"
+        << ", not pruned " << n - pruned << " (" << rate(n - pruned) << "%)";
+    return ss.str();
+}
+
+// squared distance of a point from a curve, i.e. from the nearest of its segments
+template <typename Point_T, typename Curve_T>
+static distance_t _point_curve_dist_sqr(const Point_T &point, const Curve_T &curve) {
+    distance_t result = std::numeric_limits<distance_t>::infinity();
+    for (curve_size_t j = 0; j < curve.complexity() - 1; ++j) {
+        if (curve[j].dist_sqr(curve[j+1]) > 0) {
+            result = std::min(result, point.line_segment_dist_sqr(curve[j], curve[j+1]));
+        } else {
+            result = std::min(result, point.dist_sqr(curve[j]));
+        }
+    }
+    return result;
+}
+
+template <typename Curve_T>
+distance_t _projective_lower_bound(const Curve_T &curve1, const Curve_T &curve2, const distance_t best, const bool projective) {
+    const curve_size_t n1 = curve1.complexity(), n2 = curve2.complexity();
+    const distance_t best_sqr = best * best;
+    const bool count = best < std::numeric_limits<distance_t>::infinity();
+    if (count) ++bound_statistics.calls;
+    
+    // endpoints: every traversal starts and ends at them
+    distance_t result = std::max(curve1[0].dist_sqr(curve2[0]), curve1[n1-1].dist_sqr(curve2[n2-1]));
+    if (result >= best_sqr) {
+        ++bound_statistics.endpoints;
+        return std::sqrt(result);
+    }
     
-    for (curve_size_t i = 0; i < curve1.complexity(); ++i) {
-        #pragma omp parallel for
-        for (curve_size_t j = 0; j < curve2.complexity() - 1; ++j) {
-            if (curve2[j].dist_sqr(curve2[j+1]) > 0) {
-                distances1_sqr[j] = curve1[i].line_segment_dist_sqr(curve2[j], curve2[j+1]);
-            } else {
-                distances1_sqr[j] = curve1[i].dist_sqr(curve2[j]);
-            }
+    // bounding boxes: the extreme points of a curve in each coordinate have to be matched within the distance
+    const dimensions_t dimensions = curve1.dimensions();
+    for (dimensions_t k = 0; k < dimensions; ++k) {
+        distance_t min1 = curve1[0][k], max1 = min1, min2 = curve2[0][k], max2 = min2;
+        for (curve_size_t i = 1; i < n1; ++i) {
+            min1 = std::min(min1, distance_t(curve1[i][k]));
+            max1 = std::max(max1, distance_t(curve1[i][k]));
+        }
+        for (curve_size_t j = 1; j < n2; ++j) {
+            min2 = std::min(min2, distance_t(curve2[j][k]));
+            max2 = std::max(max2, distance_t(curve2[j][k]));
         }
-        distances2_sqr[i] = *std::min_element(distances1_sqr.begin(), distances1_sqr.end());
+        const distance_t gap = std::max(std::abs(min1 - min2), std::abs(max1 - max2));
+        result = std::max(result, gap * gap);
+    }
+    if (result >= best_sqr) {
+        ++bound_statistics.bounding_box;
+        return std::sqrt(result);
+    }
+    
+    // a few sampled vertices, each of them has to be matched to some point of the other curve
+    const curve_size_t samples = 16;
+    for (curve_size_t i = 0; i < n1; i += std::max(curve_size_t(1), n1 / samples)) {
+        result = std::max(result, _point_curve_dist_sqr(curve1[i], curve2));
+    }
+    for (curve_size_t j = 0; j < n2; j += std::max(curve_size_t(1), n2 / samples)) {
+        result = std::max(result, _point_curve_dist_sqr(curve2[j], curve1));
+    }
+    if (result >= best_sqr) {
+        ++bound_statistics.sampled;
+        return std::sqrt(result);
     }
     
-    distances1_sqr = std::vector<distance_t>(curve1.complexity() - 1);
+    if (!projective) return std::sqrt(result);
     
-    for (curve_size_t i = 0; i < curve2.complexity(); ++i) {
-        #pragma omp parallel for
-        for (curve_size_t j = 0; j < curve1.complexity() - 1; ++j) {
-            if (curve1[j].dist_sqr(curve1[j+1]) > 0) {
-                distances1_sqr[j] = curve2[i].line_segment_dist_sqr(curve1[j], curve1[j+1]);
-            } else {
-                distances1_sqr[j] = curve2[i].dist_sqr(curve1[j]);
-            }
+    // every vertex, stopping as soon as best is reached
+    for (curve_size_t i = 0; i < n1; ++i) {
+        result = std::max(result, _point_curve_dist_sqr(curve1[i], curve2));
+        if (result >= best_sqr) {
+            ++bound_statistics.projective;
+            return std::sqrt(result);
         }
-        distances2_sqr[curve1.complexity() + i] = *std::min_element(distances1_sqr.begin(), distances1_sqr.end());
     }
-    
-    distances2_sqr[curve1.complexity() + curve2.complexity()] = curve1[0].dist_sqr(curve2[0]);
-    distances2_sqr[curve1.complexity() + curve2.complexity() + 1] = curve1[curve1.complexity()-1].dist_sqr(curve2[curve2.complexity()-1]);
-    return std::sqrt(*std::max_element(distances2_sqr.begin(), distances2_sqr.end()));
+    for (curve_size_t j = 0; j < n2; ++j) {
+        result = std::max(result, _point_curve_dist_sqr(curve2[j], curve1));
+        if (result >= best_sqr) {
+            ++bound_statistics.projective;
+            return std::sqrt(result);
+        }
+    }
+    return std::sqrt(result);
 }
 
+template Distance distance(const Curve&, const Curve&);
+template Distance distance(const Planar_Curve&, const Planar_Curve&);
+template Distance distance(const Curve&, const Curve&, Workspace&);
+template Distance distance(const Planar_Curve&, const Planar_Curve&, Workspace&);
+template bool less_than(const Curve&, const Curve&, const distance_t);
+template bool less_than(const Planar_Curve&, const Planar_Curve&, const distance_t);
+template bool less_than(const Curve&, const Curve&, const distance_t, Workspace&);
+template bool less_than(const Planar_Curve&, const Planar_Curve&, const distance_t, Workspace&);
+template Distance _distance(const Curve&, const Curve&, distance_t, distance_t);
+template Distance _distance(const Planar_Curve&, const Planar_Curve&, distance_t, distance_t);
+template Distance _distance(const Curve&, const Curve&, distance_t, distance_t, Workspace&);
+template Distance _distance(const Planar_Curve&, const Planar_Curve&, distance_t, distance_t, Workspace&);
+template bool _less_than_or_equal(const distance_t, const Curve&, const Curve&, Workspace&);
+template bool _less_than_or_equal(const distance_t, const Planar_Curve&, const Planar_Curve&, Workspace&);
+template void _free_space_cells(const Curve&, const Curve&, Workspace&);
+template void _free_space_cells(const Planar_Curve&, const Planar_Curve&, Workspace&);
+template distance_t _greedy_upper_bound(const Curve&, const Curve&);
+template distance_t _greedy_upper_bound(const Planar_Curve&, const Planar_Curve&);
+template distance_t _projective_lower_bound(const Curve&, const Curve&, const distance_t, const bool);
+template distance_t _projective_lower_bound(const Planar_Curve&, const Planar_Curve&, const distance_t, const bool);
+
 } // end namespace Continuous
 
 namespace Discrete {
@@ -259,7 +419,6 @@ Distance distance(const Curve &curve1, const Curve &curve2) {
     std::vector<std::vector<distance_t>> a(curve1.complexity(), std::vector<distance_t>(curve2.complexity()));
     std::vector<std::vector<distance_t>> dists(curve1.complexity(), std::vector<distance_t>(curve2.complexity()));
     
-    #pragma omp parallel for collapse(2)
     for (curve_size_t i = 0; i < curve1.complexity(); ++i) {
         for (curve_size_t j = 0; j < curve2.complexity(); ++j) {
             dists[i][j] = curve1[i].dist_sqr(curve2[j]);
@@ -10,11 +10,14 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #pragma once
 
+#include <atomic>
+
 #include "config.hpp"
 #include "types.hpp"
 #include "point.hpp"
 #include "interval.hpp"
 #include "curve.hpp"
+#include "planar.hpp"
 
 namespace Frechet {
 namespace Continuous {
@@ -30,16 +33,101 @@ namespace Continuous {
         std::string repr() const;
     };
     
-    Distance distance(const Curve&, const Curve&);
+    /*
+    Free space diagram of a pair of curves of n1 and n2 vertices. Only the distance independent geometry of its cells is
+    stored (flat, row-major, cell (i, j) at i * n2 + j): it is computed once per pair and every decision of the binary search
+    turns it into free intervals for its own distance on the fly, keeping just two rows of the reachable space.
+    The storage only grows, to the largest pair it has been used for, so one workspace serves the whole binary search
+    and every later distance computation without touching the allocator. It is not thread safe: each thread needs its own.
+    */
+    class Workspace {
+    public:
+        /*
+        A segment and a point: at distance eps the free part of the segment is
+        [center - sqrt((eps^2 - height_sqr) * inv_length_sqr), center + sqrt(...)] clipped to [0, 1],
+        and it is empty when eps^2 < height_sqr.
+        */
+        struct Cell {
+            distance_t center;          // parameter of the projection of the point on the line of the segment
+            distance_t height_sqr;      // squared distance of the point from that line (from the segment if it is a single point)
+            distance_t inv_length_sqr;  // 1 / squared length of the segment, 0 if it is a single point
+            
+            inline Interval free_interval(const distance_t dist_sqr) const {
+                const distance_t slack = dist_sqr - height_sqr;
+                if (slack < 0) return Interval();
+                if (inv_length_sqr == 0) return Interval(parameter_t(0), parameter_t(1));
+                const distance_t half_width = std::sqrt(slack * inv_length_sqr);
+                return Interval(std::max(distance_t(0), center - half_width), std::min(distance_t(1), center + half_width));
+            }
+        };
+        
+        curve_size_t n1 = 0, n2 = 0;
+        std::vector<Cell> cells1;   // segment [i, i+1] of curve1 and vertex j of curve2
+        std::vector<Cell> cells2;   // segment [j, j+1] of curve2 and vertex i of curve1
+        Distances border1, border2; // squared distances of curve2[0] to curve1[i+1] and of curve1[0] to curve2[j+1]
+        Parameters rows;            // reachable space of the previous and the current row, 4 x n2
+        
+        // sizes the workspace for an n1 x n2 pair
+        void prepare(const curve_size_t n1, const curve_size_t n2);
+        
+        inline Cell& cell1(const curve_size_t i, const curve_size_t j) { return cells1[i * n2 + j]; }
+        inline Cell& cell2(const curve_size_t i, const curve_size_t j) { return cells2[i * n2 + j]; }
+    };
+    
+    // workspace of the calling thread, used by the overloads below that do not take one
+    Workspace& thread_workspace();
+    
+    // how many of the lower bounds asked with a best-so-far were settled by each layer of _projective_lower_bound
+    struct Bound_Statistics {
+        std::atomic<std::size_t> calls{0}, endpoints{0}, bounding_box{0}, sampled{0}, projective{0};
+        
+        std::string repr() const;
+    };
+    
+    extern Bound_Statistics bound_statistics;
+    
+    // the algorithms below are instantiated (in frechet.cpp) for Curve and for Planar_Curve
+    template <typename Curve_T>
+    Distance distance(const Curve_T&, const Curve_T&);
+    template <typename Curve_T>
+    Distance distance(const Curve_T&, const Curve_T&, Workspace&);
     
-    Distance _distance(const Curve&, const Curve&, distance_t, distance_t);
+    /*
+    Decides whether the distance of the curves is below eps, without computing it: the cheap bounds (endpoints, greedy
+    upper bound) answer most calls and the rest cost a single free space reachability check instead of a binary search.
+    Curves at distance exactly eps may go either way.
+    */
+    template <typename Curve_T>
+    bool less_than(const Curve_T&, const Curve_T&, const distance_t);
+    template <typename Curve_T>
+    bool less_than(const Curve_T&, const Curve_T&, const distance_t, Workspace&);
+    
+    template <typename Curve_T>
+    Distance _distance(const Curve_T&, const Curve_T&, distance_t, distance_t);
+    template <typename Curve_T>
+    Distance _distance(const Curve_T&, const Curve_T&, distance_t, distance_t, Workspace&);
             
-    bool _less_than_or_equal(const distance_t, const Curve&, const Curve&, 
-            std::vector<Parameters>&, std::vector<Parameters>&, 
-            std::vector<Intervals>&, std::vector<Intervals>&);
+    template <typename Curve_T>
+    bool _less_than_or_equal(const distance_t, const Curve_T&, const Curve_T&, Workspace&);
+    
+    // fills the cells of the workspace for a pair of curves, once for all the decisions about that pair
+    template <typename Curve_T>
+    void _free_space_cells(const Curve_T&, const Curve_T&, Workspace&);
+    
+    // decision on the cells already in the workspace: is the distance at most the given one
+    bool _reachable(const distance_t, Workspace&);
             
-    distance_t _greedy_upper_bound(const Curve&, const Curve&);
-    distance_t _projective_lower_bound(const Curve&, const Curve&);
+    template <typename Curve_T>
+    distance_t _greedy_upper_bound(const Curve_T&, const Curve_T&);
+    
+    /*
+    Lower bound in layers of growing cost: endpoint distances, bounding boxes, the distance of a few sampled vertices from
+    the other curve and, only if projective is set, the distance of every vertex from the other curve. Stops at the first
+    layer that reaches best (the caller's best-so-far), so the result is only exact when it stays below best.
+    */
+    template <typename Curve_T>
+    distance_t _projective_lower_bound(const Curve_T&, const Curve_T&, 
+            const distance_t best = std::numeric_limits<distance_t>::infinity(), const bool projective = true);
 }
 namespace Discrete {
     
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "types.hpp"
+#include "interval.hpp"
+
+/*
+Fixed dimension counterparts of Point and Curve for curves in the plane. A Planar_Point is two coordinates held by value
+(no heap allocation per point) and a Planar_Curve keeps its vertices packed as x1,y1,x2,y2,... in a single vector.
+The continuous Frechet algorithms in frechet.cpp are instantiated for both Curve and Planar_Curve.
+*/
+
+class Planar_Point {
+public:
+    coordinate_t x, y;
+
+    inline Planar_Point() : x{0}, y{0} {}
+
+    inline Planar_Point(const coordinate_t x, const coordinate_t y) : x{x}, y{y} {}
+
+    inline dimensions_t dimensions() const {
+        return 2;
+    }
+    
+    inline coordinate_t operator[](const dimensions_t i) const {
+        return i == 0 ? x : y;
+    }
+
+    inline Planar_Point operator+(const Planar_Point &point) const {
+        return Planar_Point(x + point.x, y + point.y);
+    }
+
+    inline Planar_Point operator-(const Planar_Point &point) const {
+        return Planar_Point(x - point.x, y - point.y);
+    }
+
+    template<typename T>
+    inline Planar_Point operator*(const T mult) const {
+        return Planar_Point(x * mult, y * mult);
+    }
+
+    inline distance_t operator*(const Planar_Point &point) const {
+        return x * point.x + y * point.y;
+    }
+
+    inline distance_t dist_sqr(const Planar_Point &point) const {
+        const distance_t dx = x - point.x, dy = y - point.y;
+        return dx * dx + dy * dy;
+    }
+
+    inline distance_t dist(const Planar_Point &point) const {
+        return std::sqrt(dist_sqr(point));
+    }
+
+    inline distance_t length_sqr() const {
+        return x * x + y * y;
+    }
+
+    inline distance_t line_segment_dist_sqr(const Planar_Point &p1, const Planar_Point &p2) const {
+        const Planar_Point u = p2 - p1;
+        parameter_t projection_param = (*this - p1) * u / (u * u);
+        if (projection_param < parameter_t(0)) projection_param = parameter_t(0);
+        else if (projection_param > parameter_t(1)) projection_param = parameter_t(1);
+        const Planar_Point projection = p1 + u * projection_param;
+        return projection.dist_sqr(*this);
+    }
+
+    inline Interval ball_intersection_interval(const distance_t distance_sqr, const Planar_Point &line_start, const Planar_Point &line_end) const {
+        const Planar_Point u = line_end - line_start, v = *this - line_start;
+        const parameter_t ulen_sqr = u.length_sqr(), vlen_sqr = v.length_sqr();
+
+        if (near_eq(ulen_sqr, parameter_t(0))) {
+            if (vlen_sqr <= distance_sqr) return Interval(parameter_t(0), parameter_t(1));
+            else return Interval();
+        }
+
+        const parameter_t p = -2. * ((u * v) / ulen_sqr), q = vlen_sqr / ulen_sqr - distance_sqr / ulen_sqr;
+
+        const parameter_t phalf_sqr = p * p / 4., discriminant = phalf_sqr - q;
+
+        if (discriminant < 0) return Interval();
+
+        const parameter_t discriminant_sqrt = std::sqrt(discriminant);
+
+        const parameter_t minus_p_h = - p / 2., r1 = minus_p_h + discriminant_sqrt, r2 = minus_p_h - discriminant_sqrt;
+        const parameter_t lambda1 = std::min(r1, r2), lambda2 = std::max(r1, r2);
+
+        return Interval(std::max(parameter_t(0), lambda1), std::min(parameter_t(1), lambda2));
+    }
+};
+
+class Planar_Curve {
+    std::vector<Planar_Point> points;
+    std::string name;
+
+public:
+    inline Planar_Curve(const std::string &name = "unnamed curve") : name{name} {}
+
+    // copies m vertices whose coordinates are read every stride values starting at xs and ys
+    inline Planar_Curve(const coordinate_t *xs, const coordinate_t *ys, const curve_size_t m, const curve_size_t stride = 1, const std::string &name = "unnamed curve") : name{name} {
+        points.reserve(m);
+        for (curve_size_t i = 0; i < m; ++i) {
+            points.push_back(Planar_Point(xs[i * stride], ys[i * stride]));
+        }
+    }
+
+    inline const Planar_Point& operator[](const curve_size_t i) const {
+        return points[i];
+    }
+
+    inline Planar_Point& operator[](const curve_size_t i) {
+        return points[i];
+    }
+
+    inline const Planar_Point& front() const {
+        return points.front();
+    }
+
+    inline const Planar_Point& back() const {
+        return points.back();
+    }
+
+    inline bool empty() const {
+        return points.empty();
+    }
+
+    inline curve_size_t complexity() const {
+        return points.size();
+    }
+
+    inline curve_size_t size() const {
+        return points.size();
+    }
+
+    inline dimensions_t dimensions() const {
+        return empty() ? 0 : 2;
+    }
+
+    inline void push_back(const Planar_Point &point) {
+        points.push_back(point);
+    }
+
+    inline std::string get_name() const {
+        return name;
+    }
+};
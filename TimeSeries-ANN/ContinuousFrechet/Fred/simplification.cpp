@@ -26,6 +26,8 @@ Curve Simplification::approximate_minimum_link_simplification(const Curve &pcurv
         
         segment[0] = curve[i];
         j = 0;
+        // the error of the previous shortcut must not stop the search before it starts (j would stay 0 and pow(2, j - 1) underflows)
+        distance = 0;
         
         if (Config::verbosity > 1) std::cout << "ASIMPL: computing maximum shortcut starting at " << i << std::endl;
         
@@ -86,6 +88,8 @@ Curve Simplification::approximate_minimum_error_simplification(const Curve &curv
         max_distance *= 2.;
         new_simplification = Simplification::approximate_minimum_link_simplification(curve, max_distance);
     }
+    // a valid answer even if the binary search below never improves on it
+    simplification = new_simplification;
     
     if (Config::verbosity > 1) std::cout << "ASIMPL: binary search using upper bound" << std::endl;
     const distance_t epsilon = std::max(min_distance * Frechet::Continuous::error / 100, std::numeric_limits<distance_t>::epsilon());
@@ -79,7 +79,6 @@ public:
             
             if (i == 0) {
                 if (Config::verbosity > 1) std::cout << "SIMPL: initializing arrays" << std::endl;
-                #pragma omp parallel for
                 for (curve_size_t j = 1; j < curve.complexity(); ++j) {
                     distances[j][0] = edges[0][j];
                     predecessors[j][0] = 0;
@@ -88,7 +87,6 @@ public:
                 for (curve_size_t j = 1; j < curve.complexity(); ++j) {
                     if (Config::verbosity > 1) std::cout << "SIMPL: computing shortcut using " << i << " jumps" << std::endl;
                     others.resize(j);
-                    #pragma omp parallel for
                     for (curve_size_t k = 0; k < j; ++k) {
                         others[k] = std::max(distances[k][i - 1], edges[k][j]);
                     }
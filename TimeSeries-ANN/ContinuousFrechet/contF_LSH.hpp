@@ -6,144 +6,122 @@
 #include <time.h>
 #include <math.h>
 #include <set>
+#include <limits>
+#include <unordered_map>
 
 #include "./cont_Frechet.hpp"
 #include "../DiscreteFrechet/disc_Frechet.hpp"
 #include "../../includes/curves.hpp"
+#include "../../includes/grid_curves.hpp"
+#include "../../includes/parallel.hpp"
 #include "../L2/LSH.hpp"
 
 namespace cF
 {
     // minima maxima y removing from π˜ = v1, . . . , v` any vi s.t. vi ∈ [min{vi−1, vi+1}, max{vi−1, vi+1}]
     // στο min/max αφαιρoύμε ενα στοιχειο αν ειναι μεγαλυτερο απο το προηγουμενο του και μικροτερο απο το επομενο του ή αν ειναι ισο με ενα απο τα 2
-    void minima_maxima(vector<double> &p)
+    bool minima_maxima_cut(double before, double value, double after) // true if value has to be removed from between its neighbours
     {
-        int og_size = p.size();
-        int i = 0;
-        int cuts = 0;
-        int total_cuts = 0;
-        while (i + 2 < p.size())
-        {
-            cuts = 0;
-            if (((p[i + 1] > min(p[i], p[i + 2])) && (p[i + 1] > max(p[i], p[i + 2]))) || p[i + 1] == p[i] || p[i + 1] == p[i + 2])
-            {
-                // cout << p[i] << " " << p[i+1] << " " << p[i+2] << endl;
-                p.erase(p.begin() + i + 1); // erase element i+1
-                cuts++;
-                // cout << "cut1" << endl;
-                total_cuts++;
-            }
-            if (cuts == 0)
-                i++;
-        }
-        while (cuts != 0)
-        {
-            cuts = 0;
-            i--;
-            if (((p[i + 1] > min(p[i], p[i + 2])) && (p[i + 1] > max(p[i], p[i + 2]))) || p[i + 1] == p[i] || p[i + 1] == p[i + 2])
-            {
-                p.erase(p.begin() + i + 1); // erase element i+1
-                cuts++;
-                // cout << "cut2" << endl;
-                total_cuts++;
-            }
-        }
-
-        cout << "minima_maxima cut " << total_cuts << " points out of " << og_size << endl;
-        return;
+        return ((value > min(before, after)) && (value > max(before, after))) || value == before || value == after;
     }
 
-    void filter_curve(curves::Curve2d &curve, double e) // for any consecutive points a, b, c, if |a − b| ≤ ε and |b − c| ≤ ε then remove b
+    /* Removes, in place and in a single pass, the middle one of three consecutive elements (indices of the kept element before
+    it, of itself and of the element after it) whenever cut(before, value, after) holds, and returns how many elements remain.
+    move(to, from) copies element from over element to. Every element is checked against the last one that was kept and the
+    next one, and (like the old erase-based filters) when the very last check cuts an element we keep checking backwards. */
+    template <typename Cut, typename Move>
+    int compact(int n, Cut cut, Move move)
     {
-        int og_size = curve.data.size();
-        int i=0;
-        int cuts=0;
-        int total_cuts=0;
-        while(i+2 < curve.data.size())
+        if (n < 3)
+            return n;
+
+        int kept = 1; // elements 0, ..., kept - 1 are kept
+        bool last_cut = false;
+        for (int i = 2; i < n; i++)
         {
-            cuts=0;
-            if((point2d_L2(curve.data[i], curve.data[i+1]) <= e) && (point2d_L2(curve.data[i+1], curve.data[i+2]) <= e))
-            {
-                curve.data.erase(curve.data.begin()+i+1); // erase element i+1
-                cuts++;
-                total_cuts++;
-            }
-            if(cuts==0)
-                i++;
+            // element i - 1 has not been overwritten yet, since only elements before kept <= i - 1 are written
+            last_cut = cut(kept - 1, i - 1, i);
+            if (!last_cut)
+                move(kept++, i - 1);
         }
-        while(cuts!=0)
+        move(kept++, n - 1);
+
+        while (last_cut && kept >= 3 && cut(kept - 3, kept - 2, kept - 1))
         {
-            cuts=0;
-            i--;
-            if((point2d_L2(curve.data[i], curve.data[i+1]) <= e) && (point2d_L2(curve.data[i+1], curve.data[i+2]) <= e))
-            {
-                curve.data.erase(curve.data.begin()+i+1); // erase element i+1
-                cuts++;
-                total_cuts++;
-            }
+            move(kept - 2, kept - 1);
+            kept--;
         }
+        return kept;
+    }
+
+    // minima_maxima on the n values starting at p, returns the number of values that remain at the start of p
+    int minima_maxima(double *p, int n)
+    {
+        return compact(
+            n, [p](int before, int value, int after)
+            { return minima_maxima_cut(p[before], p[value], p[after]); },
+            [p](int to, int from)
+            { p[to] = p[from]; });
+    }
 
-        // cout << "filtering cut " << total_cuts << " points out of "<< og_size << endl;
-        return;
+    void minima_maxima(vector<double> &p)
+    {
+        p.resize(minima_maxima(p.data(), p.size()));
     }
 
-    void filter_curve(vector<curves::Point2d> &curve, double e) // for any consecutive points a, b, c, if |a − b| ≤ ε and |b − c| ≤ ε then remove b
+    // for any consecutive points a, b, c, if |a − b| ≤ ε and |b − c| ≤ ε then remove b
+    // (applied to the n points with coordinates x and y, returns the number of points that remain)
+    int filter_curve(double *x, double *y, int n, double e)
     {
-        int og_size = curve.size();
-        int i=0;
-        int cuts=0;
-        int total_cuts=0;
-        while(i+2 < curve.size())
-        {
-            cuts=0;
-            if((point2d_L2(curve[i], curve[i+1]) <= e) && (point2d_L2(curve[i+1], curve[i+2]) <= e))
-            {
-                curve.erase(curve.begin()+i+1); // erase element i+1
-                cuts++;
-                total_cuts++;
-            }
-            if(cuts==0)
-                i++;
-        }
-        while(cuts!=0)
-        {
-            cuts=0;
-            i--;
-            if((point2d_L2(curve[i], curve[i+1]) <= e) && (point2d_L2(curve[i+1], curve[i+2]) <= e))
-            {
-                curve.erase(curve.begin()+i+1); // erase element i+1
-                cuts++;
-                total_cuts++;
-            }
-        }
+        auto close = [x, y, e](int a, int b)
+        { return sqrt(pow(x[a] - x[b], 2) + pow(y[a] - y[b], 2)) <= e; };
+        return compact(
+            n, [&close](int before, int value, int after)
+            { return close(before, value) && close(value, after); },
+            [x, y](int to, int from)
+            { x[to] = x[from]; y[to] = y[from]; });
+    }
 
-        // cout << "filtering cut " << total_cuts << " points out of "<< og_size << endl;
-        return;
+    void filter_curve(vector<curves::Point2d> &curve, double e)
+    {
+        curves::Point2d *p = curve.data();
+        int n = compact(
+            curve.size(), [p, e](int before, int value, int after)
+            { return point2d_L2(p[before], p[value]) <= e && point2d_L2(p[value], p[after]) <= e; },
+            [p](int to, int from)
+            { p[to] = p[from]; });
+        curve.erase(curve.begin() + n, curve.end());
     }
 
-    void filter_curves(vector<curves::Curve2d> &curve_dataset, double e)
+    // filters every curve of the dataset in place and in parallel (curves stop sharing their time axis, since each one keeps different vertices)
+    void filter_curves(curves::CurveDataset &curve_dataset, double e)
     {
-        for (int i = 0; i < curve_dataset.size(); i++)
+        curve_dataset.detach_axis();
+        int n = curve_dataset.size();
+        int n_chunks = parallel::chunks(n, 16);
+        int chunk_size = (n + n_chunks - 1) / n_chunks;
+        // every curve owns its slot, so chunks of curves can be filtered at the same time
+        parallel::for_each_task(n_chunks, [&](int chunk, int)
         {
-            // cout << "curve#" << i << ": ";
-            filter_curve(curve_dataset[i], e);
-        }
+            int first = chunk * chunk_size;
+            int last = std::min(n, first + chunk_size);
+            for (int i = first; i < last; i++)
+                curve_dataset.shrink(i, filter_curve(curve_dataset.x_data(i), curve_dataset.y_data(i), curve_dataset.view(i).size(), e));
+        });
     }
 }
 
 namespace cFLSH
 {
-    // creates associations between curve, grid-curve and vector x items
+    // creates associations between a curve of the dataset and its grid-curve (both kept as indices)
     class Association
     {
     public:
-        curves::Curve2d *curve;
-        vector<double> *grid_curve;
-        vector<double> *x;
+        uint32_t curve;      // index of the curve in the dataset
+        uint32_t grid_curve; // index of the grid-curve in the GridCurveStore (only kept with the querying trick)
 
-        Association(curves::Curve2d *curve, vector<double> *grid_curve, vector<double> *x) : curve(curve),
-                                                                                             grid_curve(grid_curve),
-                                                                                             x(x) {}
+        Association(uint32_t curve, uint32_t grid_curve) : curve(curve),
+                                                           grid_curve(grid_curve) {}
     };
 
     class LSH
@@ -156,20 +134,25 @@ namespace cFLSH
         double delta;
         int tableSize;
         int datasize;                      // size of each table
-        vector<vector<double>> h_curves;       // stores grid-curves after snapping and minima_maxima
-        vector<vector<double>> x_vecs;         // stores real vectors x (after padding)
+        curves::GridCurveStore h_curves;       // stores grid-curves after snapping and minima_maxima (packed)
         std::vector<Association> **hashTables; // Association* hashTables;
+        bool querying_trick; // true if the tables below are built, so that search_ANN() can use the querying trick
+        // for each table, grid-curve fingerprint -> curves with that grid-curve (used by the querying trick)
+        vector<std::unordered_map<uint64_t, vector<Association>>> exact_tables;
         double *t;                             // stores shifts for all grids
         double padding = 10000;
         G *g_family;
+        cF::PlanarCache planar_dataset; // dataset curves converted once for the continuous Frechet computations
 
     public:
-        LSH(vector<curves::Curve2d> *dataset, int L, double delta, int divisor_for_tableSize) : dataset(dataset),
-                                                                                                                           L(L),
-                                                                                                                           delta(delta),
-                                                                                                                           tableSize(dataset->size() / divisor_for_tableSize),
-                                                                                                                           eng(time(0) + clock()),
-                                                                                                                           urd(0.0, delta)
+        LSH(vector<curves::Curve2d> *dataset, int L, double delta, int divisor_for_tableSize, bool querying_trick = false) : eng(time(0) + clock()),
+                                                                                                                             urd(0.0, delta),
+                                                                                                                             dataset(dataset),
+                                                                                                                             L(L),
+                                                                                                                             delta(delta),
+                                                                                                                             tableSize(dataset->size() / divisor_for_tableSize),
+                                                                                                                             querying_trick(querying_trick),
+                                                                                                                             exact_tables(querying_trick ? L : 0)
         {
             // tune windowSize
             std::random_device rd;                                          // only used once to initialise (seed) engine
@@ -202,17 +185,11 @@ namespace cFLSH
                 t[i] = urd(eng);
             }
 
+            this->planar_dataset.rebuild(*dataset);
+
             // Hash all items in dataset and insert them into their buckets
 
             this->dataset_hashing();
-            for (int i = 0; i < this->L; i++)
-            {
-                std::cout << "TABLE " << i << std::endl;
-                for (int j = 0; j < this->tableSize; j++)
-                {
-                    std::cout << "BUCKET " << j << " has " << this->hashTables[i][j].size() << std::endl;
-                }
-            }
         };
 
         ~LSH()
@@ -226,164 +203,196 @@ namespace cFLSH
             delete t;
         }
 
-        // maps curve P to a 1D grid
-        vector<double> snap_to_1dgrid(curves::Curve2d &curve, double t)
+        /* Maps curve P to the 1D grid of table i, filters it and hashes it, in one pass and without allocating. The grid-curve
+        (x1,y1,x2,y2,... snapped, with consecutive duplicates and minima_maxima removed) is written to the start of scratch and
+        padded back to the number of points of the curve. Returns the hash value of the padded vector x and sets grid_size to the
+        number of values of the grid-curve itself. scratch only ever grows, so once it fits the longest curve no more
+        allocations happen. */
+        unsigned int snap_and_hash(const curves::CurveView &curve, int i, vector<double> &scratch, uint32_t &grid_size)
         {
-            int starting_size = curve.data.size();
-            vector<double> snap_pis;
+            int starting_size = curve.size();
+            if (scratch.size() < 2 * starting_size)
+                scratch.resize(2 * starting_size);
 
-            // follow <<xi' = floor((x-t)/δ + 1/2)*δ + t>> formula to perform snapping
-            for (int i = 0; i < starting_size; i++)
+            int written = 0;
+            for (int p = 0; p < starting_size; p++)
             {
-                double snap_x = floor((curve.data[i].x - t) / this->delta + 0.5) * this->delta + t;
-                double snap_y = floor((curve.data[i].y - t) / this->delta + 0.5) * this->delta + t;
-                snap_pis.push_back(snap_x);
-                snap_pis.push_back(snap_y);
-            }
+                // follow <<xi' = floor((x-t)/δ + 1/2)*δ + t>> formula to perform snapping
+                double snapped[2] = {floor((curve.x(p) - t[i]) / this->delta + 0.5) * this->delta + t[i],
+                                     floor((curve.y(p) - t[i]) / this->delta + 0.5) * this->delta + t[i]};
 
-            // create new vector without consecutive duplicates
-            vector<double> clean_pis;
-            clean_pis.push_back(snap_pis[0]);
-            for (int i = 1; i < starting_size; i++)
-            {
-                if ((snap_pis[i] != clean_pis.back()))
+                // skip consecutive duplicates
+                for (int c = 0; c < 2; c++)
                 {
-                    clean_pis.push_back(snap_pis[i]);
+                    if (written == 0 || snapped[c] != scratch[written - 1])
+                        scratch[written++] = snapped[c];
                 }
             }
+            written = cF::minima_maxima(scratch.data(), written);
+            grid_size = written;
 
-            return clean_pis;
-        }
+            // apply padding if needed
+            int x_size = std::max(written, starting_size);
+            std::fill(scratch.begin() + written, scratch.begin() + x_size, this->padding);
 
-        // minima maxima y removing from π˜ = v1, . . . , v` any vi s.t. vi ∈ [min{vi−1, vi+1}, max{vi−1, vi+1}]
-        // minima_maxima(vector<double> &p)
+            return this->g_family->produce_g(scratch.data(), x_size);
+        }
 
         // performs hashing to assing Association items to buckets
         void dataset_hashing()
         {
-            // repeat L times (where is L is the number of tables)
-            for (int i = 0; i < this->L; i++)
-            {
-                // for each curve
-                for (int j = 0; j < this->dataset->size(); j++)
-                {
-                    int starting_size = (*dataset)[j].data.size();
+            int n = this->dataset->size();
 
-                    // snap it to grid (remove consecutive duplicates and minima_maxima)
-                    this->h_curves.push_back(this->snap_to_1dgrid((*dataset)[j], t[i]));
-                    cF::minima_maxima(h_curves.back());
+            /* Every task snaps and hashes one chunk of the curves for one table. Its grid-curves and bucket positions are staged
+            privately and merged into the tables at the end, in task order, so no two threads ever write to the same bucket. */
+            int n_chunks = parallel::chunks(n, 64);
+            int chunk_size = (n + n_chunks - 1) / n_chunks;
+            vector<curves::GridCurveStore> staged_curves(this->L * n_chunks);
+            vector<vector<unsigned int>> staged_pos(this->L * n_chunks);
+            vector<vector<double>> scratch(parallel::workers(this->L * n_chunks)); // one per worker
 
-                    // produce vector x
-                    this->x_vecs.push_back(h_curves.back());
-
-                    // apply padding if needed
-                    int new_size = this->x_vecs.back().size();
-                    if (starting_size > new_size)
-                    {
-                        for (int z = new_size; z < starting_size; z++)
-                        {
-                            this->x_vecs.back().push_back(this->padding);
-                        }
-                    }
-
-                    // create Association between curve, grid-curve and x_vector
-                    Association ass = Association(&(*dataset)[j], &this->h_curves.back(), &this->x_vecs.back());
+            parallel::for_each_task(this->L * n_chunks, [&](int task, int worker)
+            {
+                int i = task / n_chunks; // hash table (and grid) of this task
+                int first = (task % n_chunks) * chunk_size;
+                int last = std::min(n, first + chunk_size);
 
-                    // create Item object so we can use produce_g from previous project
-                    Item *item_for_g = new Item((*dataset)[j].id, this->x_vecs.back());
+                // for each curve of the chunk
+                for (int j = first; j < last; j++)
+                {
+                    // snap it to grid (remove consecutive duplicates and minima_maxima), hash it and stage the (unpadded) grid-curve
+                    uint32_t grid_size;
+                    unsigned int hval = this->snap_and_hash((*dataset)[j].data, i, scratch[worker], grid_size);
+                    if (this->querying_trick) // the grid-curves are only compared by the querying trick
+                        staged_curves[task].add(scratch[worker].data(), grid_size);
+                    staged_pos[task].push_back(hval % (long unsigned)this->tableSize);
+                }
+            });
 
-                    // get item hash value
-                    unsigned int hval = (*this->g_family).produce_g(*item_for_g);
-                    unsigned int pos = hval % (long unsigned)this->tableSize;
-                    delete item_for_g; // we don't need it anymore
+            // merge the staged grid-curves into the arena and store the associations in the tables
+            std::size_t total_curves = 0;
+            std::size_t total_coords = 0;
+            for (int task = 0; task < staged_curves.size(); task++)
+            {
+                total_curves += staged_curves[task].size();
+                total_coords += staged_curves[task].coordinates();
+            }
+            this->h_curves.reserve(total_curves, total_coords);
 
+            for (int task = 0; task < staged_curves.size(); task++)
+            {
+                int i = task / n_chunks;
+                int first = (task % n_chunks) * chunk_size;
+                uint32_t base = this->h_curves.append(staged_curves[task]);
+                for (int k = 0; k < staged_pos[task].size(); k++)
+                {
+                    // create Association between curve and grid-curve
+                    Association ass = Association(first + k, base + k);
                     // store association in table
-                    this->hashTables[i][pos].push_back(ass);
+                    this->hashTables[i][staged_pos[task][k]].push_back(ass);
+                    // and under the fingerprint of its grid-curve
+                    if (this->querying_trick)
+                        this->exact_tables[i][this->h_curves.fingerprint(base + k)].push_back(ass);
                 }
+                staged_curves[task] = curves::GridCurveStore(); // free the staging space as we go
             }
         }
 
-        // searches for the approximate nearest neighbour of the query curve
+        /* searches for the approximate nearest neighbour of the query curve. The curves of the query's buckets (each one once, at
+        most threshold of them if threshold is not 0) are gathered first and then split among the OpenMP threads like in
+        cF::search_exactNN() (when built with "make omp") */
         std::pair<curves::Curve2d *, double> search_ANN(curves::Curve2d &query, bool querying_trick, int threshold = 0)
         {
-            int starting_size = query.data.size();
+            static thread_local vector<double> scratch; // snapped query, reused between calls
+            static thread_local vector<uint32_t> candidates; // indices of the curves to check, reused between calls
+            static thread_local vector<bool> gathered;       // gathered[j] is true if curve j is already a candidate
+            Planar_Curve planar_query = cF::planarCurve(query); // converted once for all candidates
 
             // we will store current nearest neighbour in curr_NN along with its distance from query
-            vector<double> dummy_vec;
-            for (int i = 0; i < starting_size; i++)
-                dummy_vec.push_back(0.0);
-            curves::Curve2d null_curve = curves::Curve2d("null", dummy_vec, dummy_vec);
+            static curves::Curve2d null_curve = curves::Curve2d("null"); // static, so that the returned pointer stays valid
             std::pair<curves::Curve2d *, double> curr_NN;
             curr_NN.first = &null_curve;
             curr_NN.second = std::numeric_limits<double>::max();
 
-            int searched = 0; // will be used to check if we reached threshold of checks
+            candidates.clear();
+            gathered.assign(this->dataset->size(), false);
             // for each hash table
             for (int i = 0; i < this->L; i++)
             {
-                // snap it to grid (remove consecutive duplicates and minima_maxima)
-                this->h_curves.push_back(this->snap_to_1dgrid(query, t[i]));
-                cF::minima_maxima(h_curves.back());
-
-                // produce vector x
-                this->x_vecs.push_back(h_curves.back());
+                // snap query to grid (remove consecutive duplicates and minima_maxima) and find the bucket
+                uint32_t grid_size; // values of the grid-curve itself, before padding
+                long unsigned bucket = this->snap_and_hash(query.data, i, scratch, grid_size) % (long unsigned)this->tableSize;
 
-                // apply padding if needed
-                int new_size = this->x_vecs.back().size();
-                if (starting_size > new_size)
+                // querying trick, if curve with identical grid_curve exists in bucket, return it as the ann (if the LSH was built
+                // without the trick there are no grid-curves to compare, so we fall back to scanning the bucket)
+                if(querying_trick==true && this->querying_trick)
                 {
-                    for (int z = new_size; z < starting_size; z++)
+                    // look the query's grid-curve up by its fingerprint instead of scanning the bucket
+                    auto exact = this->exact_tables[i].find(curves::GridCurveStore::fingerprint(scratch.data(), grid_size));
+                    if (exact != this->exact_tables[i].end())
                     {
-                        this->x_vecs.back().push_back(this->padding);
+                        for (int j = 0; j < exact->second.size(); j++)
+                        {
+                            // verify, fingerprints may collide
+                            if (this->h_curves.identical(exact->second[j].grid_curve, scratch.data(), grid_size))
+                            {
+                                // replace curr_NN
+                                curr_NN.first = &(*dataset)[exact->second[j].curve];
+                                curr_NN.second = cF::c_distance(this->planar_dataset[exact->second[j].curve], planar_query,
+                                                                Frechet::Continuous::thread_workspace());
+                                cout << "QUERYING TRICK returned ann for " << query.id << endl;
+                                return curr_NN;
+                            }
+                        }
                     }
                 }
 
-                // create Item object so we can use produce_g from previous project
-                Item *item_for_g = new Item(query.id, this->x_vecs.back());
-
-                // find the bucket
-                long unsigned hval = (*this->g_family).produce_g(*item_for_g);
-                long unsigned bucket = hval % (long unsigned)this->tableSize;
-                delete item_for_g; // we don't need it anymore
-
-                // querying trick, if curve with identical grid_curve exists in bucket, return it as the ann
-                if(querying_trick==true)
+                // gather the items of the bucket that were not gathered from an earlier table
+                for (int j = 0; j < this->hashTables[i][bucket].size(); j++)
                 {
-                    // for each item in the bucket
-                    for (int j = 0; j < this->hashTables[i][bucket].size(); j++)
+                    if (threshold != 0 && candidates.size() >= threshold)
+                        break;
+                    uint32_t curve = this->hashTables[i][bucket][j].curve;
+                    if (!gathered[curve])
                     {
-                        if (identical_curves(h_curves.back(), *(this->hashTables[i][bucket][j].grid_curve)))
-                        {
-                            // replace curr_NN
-                            curr_NN.first = this->hashTables[i][bucket][j].curve;
-                            curr_NN.second = cF::c_distance(*(this->hashTables[i][bucket][j].curve), query);
-                            cout << "QUERYING TRICK returned ann for " << query.id << endl;
-                            return curr_NN;
-                        }
+                        gathered[curve] = true;
+                        candidates.push_back(curve);
                     }
                 }
+            }
 
-                // for each item in the bucket
-                for (int j = 0; j < this->hashTables[i][bucket].size(); j++)
+            // each thread keeps the nearest of its candidates (and its position in candidates, to break ties as a sequential scan would)
+            int best = -1;
+            #pragma omp parallel
+            {
+                double local_dist = std::numeric_limits<double>::max();
+                int local_best = -1;
+                Frechet::Continuous::Workspace &workspace = Frechet::Continuous::thread_workspace(); // reused by all distance computations
+
+                #pragma omp for schedule(dynamic, 4) nowait
+                for (int j = 0; j < candidates.size(); j++)
                 {
-                    // check if we bumped into same curve as current nearest before doing calculations
-                    if (this->hashTables[i][bucket][j].curve->id != curr_NN.first->id)
+                    const Planar_Curve &planar_candidate = this->planar_dataset[candidates[j]];
+                    // the exact distance is only needed when the candidate beats the current nearest neighbour
+                    if (!cF::c_less_than(planar_candidate, planar_query, local_dist, workspace))
+                        continue;
+                    double cfd = cF::c_distance(planar_candidate, planar_query, workspace);
+                    if (cfd < local_dist || (cfd == local_dist && j < local_best))
                     {
-                        double cfd = cF::c_distance(*(this->hashTables[i][bucket][j].curve), query);
-                        // if nearer curve is found
-                        if (cfd < curr_NN.second)
-                        {
-                            // replace curr_NN
-                            curr_NN.first = this->hashTables[i][bucket][j].curve;
-                            curr_NN.second = cfd;
-                        }
-                        searched++;
-                        if (threshold != 0 && searched >= threshold)
-                            return curr_NN;
+                        local_dist = cfd;
+                        local_best = j;
                     }
                 }
+
+                #pragma omp critical
+                if (local_best != -1 && (local_dist < curr_NN.second || (local_dist == curr_NN.second && local_best < best)))
+                {
+                    curr_NN.second = local_dist;
+                    best = local_best;
+                }
             }
-            std::cout << "SEARCHED: " << searched << endl;
+            if (best != -1)
+                curr_NN.first = &(*dataset)[candidates[best]];
             return curr_NN;
         }
     };
@@ -7,59 +7,153 @@
 #include "../../includes/curves.hpp"
 
 #include "./Fred/frechet.hpp"
+#include "./Fred/simplification.hpp"
 
 namespace cF
 {
-    Curve fredCurve(curves::Curve2d &curve) 
-    { // converts a Curve2d object (our class) to a Curve object used in Fred folder from github to calculate continuous frechet
-        Points points(1);
-        for (int i = 0; i < curve.data.size(); i++)
+    Curve fredCurve(const curves::CurveView &curve, const std::string &name = "unnamed curve")
+    { // converts the points of a curve (our class) to a Curve object used in Fred folder from github (as 2d points)
+        Points points(2);
+        for (int i = 0; i < curve.size(); i++)
         {
-            Point point(1);
-            point.set(0, (coordinate_t)curve.data[i].x);
-
-            Point point2(1);
-            point2.set(0, (coordinate_t)curve.data[i].y);
-
+            Point point(2);
+            point.set(0, (coordinate_t)curve.x(i));
+            point.set(1, (coordinate_t)curve.y(i));
             points.add(point);
-            points.add(point2);
         }
 
-        Curve fred_curve(points, curve.id);
+        Curve fred_curve(points, name);
         return fred_curve;
     }
 
-    double c_distance(curves::Curve2d &item1, curves::Curve2d &item2)
+    Curve fredCurve(const curves::Curve2d &curve)
+    {
+        return fredCurve(curve.data, curve.id);
+    }
+
+    // bounds the complexity of a curve to ell vertices, using the approximate minimum error simplification of Fred folder
+    // (curves of at most ell vertices, or any curve if ell < 2, are left as they are)
+    void simplify_curve(std::vector<curves::Point2d> &curve, int ell)
+    {
+        if (ell < 2 || curve.size() <= ell)
+            return;
+        Curve simplification = Simplification::approximate_minimum_error_simplification(fredCurve(curve), ell);
+
+        curve.clear();
+        for (curve_size_t i = 0; i < simplification.complexity(); i++)
+        {
+            curves::Point2d point(simplification[i].get(0), simplification[i].get(1));
+            // the simplification is padded to exactly ell vertices by repeating its last one, we do not need those
+            if (curve.empty() || point.x != curve.back().x || point.y != curve.back().y)
+                curve.push_back(point);
+        }
+    }
+
+    Planar_Curve planarCurve(const curves::CurveView &curve, const std::string &name = "unnamed curve")
+    { // copies the points of a curve (our class) into a Planar_Curve, the packed 2d curve that Fred's algorithms can run on directly
+        return Planar_Curve(curve.xs, curve.ys, curve.size(), curve.stride, name);
+    }
+
+    Planar_Curve planarCurve(const curves::Curve2d &curve)
+    {
+        return planarCurve(curve.data, curve.id);
+    }
+
+    // keeps the Planar_Curve of every curve of a dataset, so that searches convert each dataset curve once and not once per query
+    class PlanarCache
+    {
+    private:
+        std::vector<Planar_Curve> planar_curves; // i-th element belongs to the i-th curve of the dataset
+
+    public:
+        PlanarCache() {}
+
+        PlanarCache(const vector<curves::Curve2d> &dataset) { this->rebuild(dataset); }
+
+        // (re)converts all curves, needed whenever the curves of the dataset change
+        void rebuild(const vector<curves::Curve2d> &dataset)
+        {
+            this->planar_curves.clear();
+            this->planar_curves.reserve(dataset.size());
+            for (int i = 0; i < dataset.size(); i++)
+                this->planar_curves.push_back(planarCurve(dataset[i]));
+        }
+
+        const Planar_Curve &operator[](int i) const { return this->planar_curves[i]; }
+
+        int size() const { return this->planar_curves.size(); }
+    };
+
+    double c_distance(const Planar_Curve &item1, const Planar_Curve &item2, Frechet::Continuous::Workspace &workspace)
+    { // continuous Frechet distance of two curves in the plane, straight from Fred's algorithms (free space diagram kept in workspace)
+        return Frechet::Continuous::distance(item1, item2, workspace).value;
+    }
+
+    double c_distance(const Planar_Curve &item1, const Planar_Curve &item2)
+    {
+        return c_distance(item1, item2, Frechet::Continuous::thread_workspace());
+    }
+
+    bool c_less_than(const Planar_Curve &item1, const Planar_Curve &item2, double eps, Frechet::Continuous::Workspace &workspace)
+    { // true if the continuous Frechet distance of the curves is below eps, cheaper than c_distance() when that is all we need to know
+        return Frechet::Continuous::less_than(item1, item2, eps, workspace);
+    }
+
+    double c_distance(const curves::CurveView &item1, const curves::CurveView &item2)
     { // "black box" function that converts our structures to Fred folder's structures to compute continuous frechet distance
-        return Frechet::Continuous::distance(fredCurve(item1), fredCurve(item2)).value;
+        return c_distance(planarCurve(item1), planarCurve(item2));
     }
 
-    
-    std::pair<curves::Curve2d *, double> search_exactNN(curves::Curve2d &query, vector<curves::Curve2d> &dataset)
-    { // searches for the exact nearest neighbour of the query curve using brute force approach
-        int size = query.data.size(); // length of curve
+    double c_distance(const curves::Curve2d &item1, const curves::Curve2d &item2)
+    {
+        return c_distance(item1.data, item2.data);
+    }
 
+    std::pair<curves::Curve2d *, double> search_exactNN(curves::Curve2d &query, vector<curves::Curve2d> &dataset, const PlanarCache &planar_dataset)
+    { // searches for the exact nearest neighbour of the query curve using brute force approach (planar_dataset must be built from dataset)
         // we will store current nearest neighbour in curr_NN along with its distance from query
-        vector<double> dummy_vec;
-        curves::Curve2d null_curve = curves::Curve2d("null", dummy_vec, dummy_vec);
+        static curves::Curve2d null_curve = curves::Curve2d("null"); // static, so that the returned pointer stays valid
         std::pair<curves::Curve2d *, double> curr_NN;
         curr_NN.first = &null_curve;
         curr_NN.second = std::numeric_limits<double>::max();
 
-        // for each curve in the dataset
-        for (int i = 0; i < dataset.size(); i++)
+        Planar_Curve planar_query = planarCurve(query);
+
+        // candidates are split among the OpenMP threads (Config::number_threads, when built with "make omp"),
+        // each one keeps its own nearest neighbour and the best of them wins in the end
+        #pragma omp parallel
         {
-            // calculate cont Frechet distance to it from given query
-            double cfd = cF::c_distance(query, dataset[i]);
-            // if nearer curve is found
-            if (cfd < curr_NN.second)
+            std::pair<curves::Curve2d *, double> local_NN = curr_NN;
+            Frechet::Continuous::Workspace &workspace = Frechet::Continuous::thread_workspace(); // reused by all distance computations
+
+            // for each curve in the dataset
+            #pragma omp for schedule(dynamic, 4) nowait
+            for (int i = 0; i < dataset.size(); i++)
             {
-                // replace curr_NN
-                curr_NN.first = &(dataset[i]);
-                curr_NN.second = cfd;
+                // skip it if it can not beat the current nearest neighbour, otherwise calculate cont Frechet distance to it from given query
+                if (!cF::c_less_than(planar_query, planar_dataset[i], local_NN.second, workspace))
+                    continue;
+                double cfd = cF::c_distance(planar_query, planar_dataset[i], workspace);
+                // if nearer curve is found
+                if (cfd < local_NN.second)
+                {
+                    // replace local_NN
+                    local_NN.first = &(dataset[i]);
+                    local_NN.second = cfd;
+                }
             }
+
+            // on ties keep the curve that comes first in the dataset, as the sequential loop would
+            #pragma omp critical
+            if (local_NN.second < curr_NN.second || (local_NN.second == curr_NN.second && local_NN.first < curr_NN.first))
+                curr_NN = local_NN;
         }
         return curr_NN;
     }
+
+    std::pair<curves::Curve2d *, double> search_exactNN(curves::Curve2d &query, vector<curves::Curve2d> &dataset)
+    { // same as above for a one-off search, without a prepared cache
+        return search_exactNN(query, dataset, PlanarCache(dataset));
+    }
 }
 #endif
\ No newline at end of file
@@ -7,23 +7,25 @@
 #include <math.h>
 #include <set>
 #include <limits>
+#include <unordered_map>
 #include "./disc_Frechet.hpp"
 #include "../../includes/curves.hpp"
+#include "../../includes/grid_curves.hpp"
+#include "../../includes/parallel.hpp"
+#include "../../includes/range_rings.hpp"
 #include "../L2/LSH.hpp"
 
 namespace dFLSH
 {
-    // creates associations between curve, grid-curve and vector x items
+    // creates associations between a curve of the dataset and its grid-curve (both kept as indices)
     class Association
     {
     public:
-        curves::Curve2d *curve;
-        vector<curves::Point2d> *grid_curve;
-        vector<double> *x;
+        uint32_t curve;      // index of the curve in the dataset
+        uint32_t grid_curve; // index of the grid-curve in the GridCurveStore (only kept with the querying trick)
 
-        Association(curves::Curve2d *curve, vector<curves::Point2d> *grid_curve, vector<double> *x) : curve(curve),
-                                                                                                      grid_curve(grid_curve),
-                                                                                                      x(x) {}
+        Association(uint32_t curve, uint32_t grid_curve) : curve(curve),
+                                                           grid_curve(grid_curve) {}
     };
 
     class LSH
@@ -37,21 +39,25 @@ namespace dFLSH
         int tableSize; // size of each table
         int datasize;
         // int windowSize;
-        vector<vector<curves::Point2d>> h_curves; // stores grid-curves
-        vector<vector<double>> x_vecs;            // stores real vectors x
+        curves::GridCurveStore h_curves;          // stores grid-curves (packed)
         std::vector<Association> **hashTables;    // Association* hashTables;
         vector<std::pair<double, double>> shifts; // stores shifts for all grids so we can snap queries on those grids
+        bool querying_trick; // true if the tables below are built, so that search_ANN() can use the querying trick
+        // for each table, grid-curve fingerprint -> curves with that grid-curve (used by the querying trick)
+        vector<std::unordered_map<uint64_t, vector<Association>>> exact_tables;
         double padding = 10000;                   // value that will replace duplicates
         G *g_family;                              // G hash family that is gonna be used for storing in 1d table
 
     public:
-        LSH(vector<curves::Curve2d> *dataset, int L, double delta, int divisor_for_tableSize, bool querying_trick = false) : dataset(dataset),
+        LSH(vector<curves::Curve2d> *dataset, int L, double delta, int divisor_for_tableSize, bool querying_trick = false) : eng(time(0) + clock()),
+                                                                                                                             urd(0.0, delta),
+                                                                                                                             dataset(dataset),
                                                                                                                              L(L),
                                                                                                                              delta(delta),
-                                                                                                                             shifts(L),
                                                                                                                              tableSize(dataset->size() / divisor_for_tableSize),
-                                                                                                                             eng(time(0) + clock()),
-                                                                                                                             urd(0.0, delta)
+                                                                                                                             shifts(L),
+                                                                                                                             querying_trick(querying_trick),
+                                                                                                                             exact_tables(querying_trick ? L : 0)
         {
             // // tune windowSize
             // std::random_device rd;                                          // only used once to initialise (seed) engine
@@ -108,133 +114,116 @@ namespace dFLSH
             delete[] hashTables;
         }
 
-        // maps curve P to a grid
-        vector<curves::Point2d> produce_h(curves::Curve2d curve, double tx, double ty)
-        {
-            int starting_size = curve.data.size();
-            vector<curves::Point2d> snap_pis; // pi'
-
-            // follow <<xi' = floor((x-t)/δ + 1/2)*δ + t>> formula to perform snapping
-            for (int i = 0; i < starting_size; i++)
-            {
-                double snap_x = floor((curve.data[i].x - tx) / this->delta + 0.5) * this->delta + tx;
-                double snap_y = floor((curve.data[i].y - ty) / this->delta + 0.5) * this->delta + ty;
-                snap_pis.push_back(curves::Point2d(snap_x, snap_y));
-            }
-
-            // create new vector without consecutive duplicates
-            vector<curves::Point2d> clean_pis;
-            clean_pis.push_back(snap_pis[0]);
-            for (int i = 1; i < starting_size; i++)
-            {
-                if ((snap_pis[i].x != clean_pis.back().x) || (snap_pis[i].y != clean_pis.back().y))
-                {
-                    clean_pis.push_back(snap_pis[i]);
-                }
-            }
-
-            return clean_pis;
-        }
-
-        // maps curve's data to a grid
-        vector<curves::Point2d> produce_h_for_data(vector<curves::Point2d> &curve, double tx, double ty)
+        /* Maps curve P to grid i and hashes it, in one pass and without allocating. The grid-curve (consecutive duplicates removed,
+        points flattened to x1,y1,x2,y2,...) is written to the start of scratch and padded back to the length of the curve.
+        Returns the hash value of the padded vector x and sets grid_size to the number of coordinates of the grid-curve itself.
+        scratch only ever grows, so once it fits the longest curve no more allocations happen. */
+        unsigned int snap_and_hash(const curves::CurveView &curve, int i, vector<double> &scratch, uint32_t &grid_size)
         {
             int starting_size = curve.size();
-            vector<curves::Point2d> snap_pis; // pi'
+            if (scratch.size() < 2 * starting_size)
+                scratch.resize(2 * starting_size);
 
-            // follow <<xi' = floor((x-t)/δ + 1/2)*δ + t>> formula to perform snapping
-            for (int i = 0; i < starting_size; i++)
+            double tx = this->shifts[i].first;
+            double ty = this->shifts[i].second;
+            int written = 0;
+            for (int p = 0; p < starting_size; p++)
             {
-                double snap_x = floor((curve[i].x - tx) / this->delta + 0.5) * this->delta + tx;
-                double snap_y = floor((curve[i].y - ty) / this->delta + 0.5) * this->delta + ty;
-                snap_pis.push_back(curves::Point2d(snap_x, snap_y));
-            }
+                // follow <<xi' = floor((x-t)/δ + 1/2)*δ + t>> formula to perform snapping
+                double snap_x = floor((curve.x(p) - tx) / this->delta + 0.5) * this->delta + tx;
+                double snap_y = floor((curve.y(p) - ty) / this->delta + 0.5) * this->delta + ty;
 
-            // create new vector without consecutive duplicates
-            vector<curves::Point2d> clean_pis;
-            clean_pis.push_back(snap_pis[0]);
-            for (int i = 1; i < starting_size; i++)
-            {
-                if ((snap_pis[i].x != clean_pis.back().x) || (snap_pis[i].y != clean_pis.back().y))
+                // skip consecutive duplicates
+                if (written == 0 || snap_x != scratch[written - 2] || snap_y != scratch[written - 1])
                 {
-                    clean_pis.push_back(snap_pis[i]);
+                    scratch[written] = snap_x;
+                    scratch[written + 1] = snap_y;
+                    written += 2;
                 }
             }
+            grid_size = written;
 
-            return clean_pis;
-        }
+            // apply padding if needed (twice for every point that was cut, because curve is 2d)
+            std::fill(scratch.begin() + written, scratch.begin() + 2 * starting_size, this->padding);
 
-        // concatenates points of grid-curve to produce a (real) vector x
-        vector<double> concat_points(vector<curves::Point2d> points)
-        {
-            vector<double> result;
-            for (int i = 0; i < points.size(); i++)
-            {
-                result.push_back(points[i].x);
-                result.push_back(points[i].y);
-            }
-            return result;
+            return this->g_family->produce_g(scratch.data(), 2 * starting_size);
         }
 
         // performs hashing to assing Association items to buckets
         void dataset_hashing()
         {
-            // repeat L times (where is L is the number of tables)
+            int n = this->dataset->size();
+
+            // produce 2 shift values (one for each dimension) for every grid and save them
             for (int i = 0; i < this->L; i++)
             {
-                // produce 2 shift values (one for each dimension)
                 double tx = urd(eng);
                 double ty = urd(eng);
-                // save them
                 this->shifts[i] = std::make_pair(tx, ty);
+            }
 
-                // for each curve
-                for (int j = 0; j < this->dataset->size(); j++)
-                {
-                    int starting_size = (*dataset)[j].data.size();
+            /* Every task snaps and hashes one chunk of the curves for one table. Its grid-curves and bucket positions are staged
+            privately and merged into the tables at the end, in task order, so no two threads ever write to the same bucket. */
+            int n_chunks = parallel::chunks(n, 64);
+            int chunk_size = (n + n_chunks - 1) / n_chunks;
+            vector<curves::GridCurveStore> staged_curves(this->L * n_chunks);
+            vector<vector<unsigned int>> staged_pos(this->L * n_chunks);
+            vector<vector<double>> scratch(parallel::workers(this->L * n_chunks)); // one per worker
 
-                    // snap it to grid
-                    this->h_curves.push_back(this->produce_h((*dataset)[j], tx, ty));
-                    int new_size = this->h_curves.back().size();
+            parallel::for_each_task(this->L * n_chunks, [&](int task, int worker)
+            {
+                int i = task / n_chunks; // hash table (and grid) of this task
+                int first = (task % n_chunks) * chunk_size;
+                int last = std::min(n, first + chunk_size);
 
-                    // produce vector x
-                    this->x_vecs.push_back(this->concat_points(this->h_curves.back()));
+                // for each curve of the chunk
+                for (int j = first; j < last; j++)
+                {
+                    // snap it to grid, hash it and stage the (unpadded) grid-curve
+                    uint32_t grid_size;
+                    unsigned int hval = this->snap_and_hash((*dataset)[j].data, i, scratch[worker], grid_size);
+                    if (this->querying_trick) // the grid-curves are only compared by the querying trick
+                        staged_curves[task].add(scratch[worker].data(), grid_size);
+                    staged_pos[task].push_back(hval % (long unsigned)this->tableSize);
+                }
+            });
 
-                    // apply padding if needed
-                    if (starting_size > new_size)
-                    {
-                        for (int z = new_size; z < starting_size; z++)
-                        {
-                            // apply twice because curve is 2d
-                            this->x_vecs.back().push_back(this->padding);
-                            this->x_vecs.back().push_back(this->padding);
-                        }
-                    }
+            // merge the staged grid-curves into the arena and store the associations in the tables
+            std::size_t total_curves = 0;
+            std::size_t total_coords = 0;
+            for (int task = 0; task < staged_curves.size(); task++)
+            {
+                total_curves += staged_curves[task].size();
+                total_coords += staged_curves[task].coordinates();
+            }
+            this->h_curves.reserve(total_curves, total_coords);
 
-                    // create Association between curve, grid-curve and vector
-                    Association ass = Association(&(*dataset)[j], &this->h_curves.back(), &this->x_vecs.back());
-                    // create Item object so we can use produce_g from previous project
-                    Item *item_for_g = new Item((*dataset)[j].id, this->x_vecs.back());
-                    // get item hash value
-                    unsigned int hval = (*this->g_family).produce_g(*item_for_g);
-                    unsigned int pos = hval % (long unsigned)this->tableSize;
-                    delete item_for_g; // we don't need it anymore
+            for (int task = 0; task < staged_curves.size(); task++)
+            {
+                int i = task / n_chunks;
+                int first = (task % n_chunks) * chunk_size;
+                uint32_t base = this->h_curves.append(staged_curves[task]);
+                for (int k = 0; k < staged_pos[task].size(); k++)
+                {
+                    // create Association between curve and grid-curve
+                    Association ass = Association(first + k, base + k);
                     // store association in table
-                    this->hashTables[i][pos].push_back(ass);
+                    this->hashTables[i][staged_pos[task][k]].push_back(ass);
+                    // and under the fingerprint of its grid-curve
+                    if (this->querying_trick)
+                        this->exact_tables[i][this->h_curves.fingerprint(base + k)].push_back(ass);
                 }
+                staged_curves[task] = curves::GridCurveStore(); // free the staging space as we go
             }
         }
 
         // searches for the approximate nearest neighbour of the query curve
         std::pair<curves::Curve2d *, double> search_ANN(curves::Curve2d &query, bool querying_trick, int threshold = 0)
         {
-            int starting_size = query.data.size();
+            static thread_local vector<double> scratch; // snapped query, reused between calls
 
             // we will store current nearest neighbour in curr_NN along with its distance from query
-            vector<double> dummy_vec;
-            for (int i = 0; i < starting_size; i++)
-                dummy_vec.push_back(0.0);
-            curves::Curve2d null_curve = curves::Curve2d("null", dummy_vec, dummy_vec);
+            static curves::Curve2d null_curve = curves::Curve2d("null"); // static, so that the returned pointer stays valid
             std::pair<curves::Curve2d *, double> curr_NN;
             curr_NN.first = &null_curve;
             curr_NN.second = std::numeric_limits<double>::max();
@@ -243,71 +232,57 @@ namespace dFLSH
             // for each hash table
             for (int i = 0; i < this->L; i++)
             {
-                // snap query it to grid
-                vector<curves::Point2d> grid_curve = this->produce_h(query, this->shifts[i].first, this->shifts[i].second);
-                int new_size = grid_curve.size();
-
-                // produce vector x
-                vector<double> x_vec = this->concat_points(grid_curve);
-
-                // apply padding if needed
-                if (starting_size > new_size)
-                {
-                    for (int z = new_size; z < starting_size; z++)
-                    {
-                        // apply twice because curve is 2d
-                        x_vec.push_back(this->padding);
-                        x_vec.push_back(this->padding);
-                    }
-                }
-
-                // create Item object so we can use produce_g from previous project
-                Item *item_for_g = new Item(query.id, x_vec);
-
-                // find the bucket
-                long unsigned id = this->g_family->produce_g(*item_for_g);
-                long unsigned bucket = id % (long unsigned)this->tableSize;
+                // snap query to grid and find the bucket
+                uint32_t grid_size; // coordinates of the grid-curve itself, before padding
+                long unsigned bucket = this->snap_and_hash(query.data, i, scratch, grid_size) % (long unsigned)this->tableSize;
 
-                delete item_for_g; // we don't need it anymore
-
-                // querying trick, check only curves with identical grid_curves
+                // querying trick, check only curves with identical grid_curves (if the LSH was built without the trick there are
+                // no grid-curves to compare, so we fall back to scanning the bucket)
                 int found = 0;
-                if (querying_trick == true)
+                if (querying_trick == true && this->querying_trick)
                 {
-                    // for each item in the bucket
-                    for (int j = 0; j < this->hashTables[i][bucket].size(); j++)
+                    // look the query's grid-curve up by its fingerprint instead of scanning the bucket
+                    auto exact = this->exact_tables[i].find(curves::GridCurveStore::fingerprint(scratch.data(), grid_size));
+                    if (exact != this->exact_tables[i].end())
                     {
-                        if (identical_curves(h_curves.back(), *(this->hashTables[i][bucket][j].grid_curve)))
+                        for (int j = 0; j < exact->second.size(); j++)
                         {
-                            double dfd = dF::discrete_frechet(*(this->hashTables[i][bucket][j].curve), query);
-                            // if nearer curve is found
-                            if (dfd < curr_NN.second)
+                            // verify, fingerprints may collide
+                            if (this->h_curves.identical(exact->second[j].grid_curve, scratch.data(), grid_size))
                             {
-                                // replace curr_NN
-                                curr_NN.first = this->hashTables[i][bucket][j].curve;
-                                curr_NN.second = dfd;
+                                curves::Curve2d *candidate = &(*dataset)[exact->second[j].curve];
+                                double dfd = dF::discrete_frechet(*candidate, query);
+                                // if nearer curve is found
+                                if (dfd < curr_NN.second)
+                                {
+                                    // replace curr_NN
+                                    curr_NN.first = candidate;
+                                    curr_NN.second = dfd;
+                                }
+                                found = 1;
                             }
-
-                            cout << "QUERYING TRICK returned ann for " << query.id << endl;
-                            found = 1;
                         }
                     }
                     if (found == 1)
+                    {
+                        cout << "QUERYING TRICK returned ann for " << query.id << endl;
                         return curr_NN;
+                    }
                 }
 
                 // for each item in the bucket
                 for (int j = 0; j < this->hashTables[i][bucket].size(); j++)
                 {
                     // check if we bumped into same curve as current nearest before doing calculations
-                    if (this->hashTables[i][bucket][j].curve->id != curr_NN.first->id)
+                    curves::Curve2d *candidate = &(*dataset)[this->hashTables[i][bucket][j].curve];
+                    if (candidate->id != curr_NN.first->id)
                     {
-                        double dfd = dF::discrete_frechet(*(this->hashTables[i][bucket][j].curve), query);
+                        double dfd = dF::discrete_frechet(*candidate, query);
                         // if nearer curve is found
                         if (dfd < curr_NN.second)
                         {
                             // replace curr_NN
-                            curr_NN.first = this->hashTables[i][bucket][j].curve;
+                            curr_NN.first = candidate;
                             curr_NN.second = dfd;
                         }
                         searched++;
@@ -320,69 +295,27 @@ namespace dFLSH
             return curr_NN;
         }
 
-        // performs the LSH range search algorithm to find nearest neighbours of query in a given radius (using discrete Frechet distance)
-        std::vector<std::pair<curves::Curve2d *, double>> RangeSearch(vector<curves::Point2d> &query, double radius, int threshold = 0)
+        /* Range search whose radius can grow (see includes/range_rings.hpp): the unmarked curves of the buckets of the query, each
+        one once, of which at most threshold are examined for every radius (0 means no limit). Without a limit all discrete
+        Frechet distances are computed at once, split among the threads. */
+        RangeRings<curves::Curve2d> IncrementalRangeSearch(const curves::CurveView &query, int threshold = 0)
         {
-            std::vector<std::pair<curves::Curve2d *, double>> neighbours;
+            static thread_local vector<double> scratch; // snapped query, reused between calls
 
-            int starting_size = query.size();
-
-            int searched = 0; // will be used to check if we reached threshold of checks
-            // for each hash table
+            std::vector<curves::Curve2d *> found;
             for (int i = 0; i < this->L; i++)
             {
-                // snap query it to grid
-                vector<curves::Point2d> grid_curve = this->produce_h_for_data(query, this->shifts[i].first, this->shifts[i].second);
-                int new_size = grid_curve.size();
-
-                // produce vector x
-                vector<double> x_vec = this->concat_points(grid_curve);
-
-                // apply padding if needed
-                if (starting_size > new_size)
-                {
-                    for (int z = new_size; z < starting_size; z++)
-                    {
-                        // apply twice because curve is 2d
-                        x_vec.push_back(this->padding);
-                        x_vec.push_back(this->padding);
-                    }
-                }
-
-                // create Item object so we can use produce_g from previous project
-                Item *item_for_g = new Item("x_vec", x_vec);
-
-                // find the bucket
-                long unsigned id = this->g_family->produce_g(*item_for_g);
-                long unsigned bucket = id % (long unsigned)this->tableSize;
-
-                delete item_for_g; // we don't need it anymore
-
-                // for each item in the bucket
+                uint32_t grid_size;
+                long unsigned bucket = this->snap_and_hash(query, i, scratch, grid_size) % (long unsigned)this->tableSize;
                 for (int j = 0; j < this->hashTables[i][bucket].size(); j++)
                 {
-                    // check if we bumped into same curve before doing calculations (and is already in neighbours vector)
-                    for (int a = 0; a < neighbours.size(); a++)
-                    {
-                        /* In the "reverse assignment with range search using LSH" clustering algorithm we mark items when they are
-                        assigned to a cluster so the next range search doesn't check them.*/
-                        if ((this->hashTables[i][bucket][j].curve->id != neighbours[a].first->id) && (this->hashTables[i][bucket][j].curve->marked == false))
-                        {
-                            double dfd = dF::discrete_frechet_for_data(this->hashTables[i][bucket][j].curve->data, query);
-                            // if curve is in radius
-                            if (dfd < radius)
-                            {
-                                // add it to the neighbours of the query
-                                neighbours.push_back(std::make_pair(hashTables[i][bucket][j].curve, dfd));
-                            }
-                            searched++;
-                            if (threshold != 0 && searched >= threshold)
-                                return neighbours;
-                        }
-                    }
+                    curves::Curve2d *candidate = &(*dataset)[this->hashTables[i][bucket][j].curve];
+                    if (candidate->marked == false)
+                        found.push_back(candidate);
                 }
             }
-            return neighbours;
+            return RangeRings<curves::Curve2d>(std::move(found), [query](const curves::Curve2d *curve)
+                                               { return dF::discrete_frechet_for_data(curve->data, query); }, threshold, 8);
         }
     };
 }
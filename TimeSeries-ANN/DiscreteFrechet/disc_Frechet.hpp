@@ -8,39 +8,93 @@
 
 namespace dF
 {
-    // recursive computation of table values for discrete Frechet distance (dynamic programming)
-    double compute_c(double **c, int i, int j, const std::vector<curves::Point2d> &p, const std::vector<curves::Point2d> &q)
+    // dynamic programming table of discrete Frechet kept in one row-major buffer, which only grows so it can be reused for many pairs
+    class Table
     {
-        // if this value has already been computed return it immediately
-        if (c[i][j] > -1)
+    private:
+        std::vector<double> cells;
+        int cols = 0;
+
+    public:
+        void resize(int rows, int cols)
+        {
+            this->cols = cols;
+            if (this->cells.size() < (std::size_t)rows * cols)
+                this->cells.resize((std::size_t)rows * cols);
+        }
+
+        inline double &operator()(int i, int j) { return this->cells[(std::size_t)i * this->cols + j]; }
+
+        inline double *row(int i) { return this->cells.data() + (std::size_t)i * this->cols; }
+    };
+
+    // computes row i of the table into curr from row i - 1 (prev, not used for the first row)
+    inline void fill_row(const double *prev, double *curr, int i, const curves::CurveView &p, const curves::CurveView &q)
+    {
+        int ql = q.size();
+        if (i == 0)
         {
-            return c[i][j];
+            curr[0] = L2(p.x(0), p.y(0), q.x(0), q.y(0));
+            for (int j = 1; j < ql; j++)
+            {
+                curr[j] = std::max(curr[j - 1], L2(p.x(0), p.y(0), q.x(j), q.y(j)));
+            }
+            return;
         }
-        else if ((i == 0) && (j > 0))
+        curr[0] = std::max(prev[0], L2(p.x(i), p.y(i), q.x(0), q.y(0)));
+        for (int j = 1; j < ql; j++)
         {
-            c[0][j] = std::max(compute_c(c, 0, j - 1, p, q), L2(p[0].x, p[0].y, q[j].x, q[j].y));
+            double temp_min = std::min(prev[j], prev[j - 1]);
+            double final_min = std::min(temp_min, curr[j - 1]);
+            curr[j] = std::max(final_min, L2(p.x(i), p.y(i), q.x(j), q.y(j)));
         }
-        else if ((i > 0) && (j == 0))
+    }
+
+    // computes the table values for discrete Frechet distance row by row (dynamic programming), c(i, j) returns entry (i, j)
+    template <typename Cell>
+    void fill_table(Cell c, const curves::CurveView &p, const curves::CurveView &q)
+    {
+        int pl = p.size();
+        int ql = q.size();
+
+        // base case
+        c(0, 0) = L2(p.x(0), p.y(0), q.x(0), q.y(0));
+
+        // first row and first column can only be reached from one direction
+        for (int j = 1; j < ql; j++)
         {
-            c[i][0] = std::max(compute_c(c, i - 1, 0, p, q), L2(p[i].x, p[i].y, q[0].x, q[0].y));
+            c(0, j) = std::max(c(0, j - 1), L2(p.x(0), p.y(0), q.x(j), q.y(j)));
         }
-        else if ((i > 0) && (j > 0))
+        for (int i = 1; i < pl; i++)
         {
-            double c1 = compute_c(c, i - 1, j, p, q);
-            double c2 = compute_c(c, i - 1, j - 1, p, q);
-            double c3 = compute_c(c, i, j - 1, p, q);
-            double temp_min = std::min(c1, c2);
-            double final_min = std::min(temp_min, c3);
-            c[i][j] = std::max(final_min, L2(p[i].x, p[i].y, q[j].x, q[j].y));
+            c(i, 0) = std::max(c(i - 1, 0), L2(p.x(i), p.y(i), q.x(0), q.y(0)));
+            for (int j = 1; j < ql; j++)
+            {
+                double temp_min = std::min(c(i - 1, j), c(i - 1, j - 1));
+                double final_min = std::min(temp_min, c(i, j - 1));
+                c(i, j) = std::max(final_min, L2(p.x(i), p.y(i), q.x(j), q.y(j)));
+            }
         }
-        return c[i][j];
+    }
+
+    // c must be a p.size() x q.size() table
+    void compute_c(double **c, const curves::CurveView &p, const curves::CurveView &q)
+    {
+        fill_table([c](int i, int j) -> double & { return c[i][j]; }, p, q);
+    }
+
+    // c is resized to p.size() x q.size() if needed
+    void compute_c(Table &c, const curves::CurveView &p, const curves::CurveView &q)
+    {
+        c.resize(p.size(), q.size());
+        fill_table([&c](int i, int j) -> double & { return c(i, j); }, p, q);
     }
 
     // calculates discrete Frechet distance between two curves (returns table of dynamic programming approach)
-    double **discrete_frechet_table(const curves::Curve2d &p, const curves::Curve2d &q)
+    double **discrete_frechet_table(const curves::CurveView &p, const curves::CurveView &q)
     {
-        int pl = p.data.size();
-        int ql = q.data.size();
+        int pl = p.size();
+        int ql = q.size();
 
         double **c = new double *[pl];
         try
@@ -49,15 +103,6 @@ namespace dF
             {
                 c[i] = new double[ql];
             }
-
-            // initialize 2d table for dynamic programming with value -1 (since distance cannot be negative)
-            for (int i = 0; i < pl; i++)
-            {
-                for (int j = 0; j < ql; j++)
-                {
-                    c[i][j] = -1;
-                }
-            }
         }
         catch (...)
         {
@@ -65,103 +110,56 @@ namespace dF
             std::cout << "pl: " << pl << " ql: " << ql << endl;
         }
 
-        // base case
-        c[0][0] = L2(p.data[0].x, p.data[0].y, q.data[0].x, q.data[0].y);
-
         // compute
-        compute_c(c, pl - 1, ql - 1, p.data, q.data);
+        compute_c(c, p, q);
 
         return c;
     }
 
-    // calculates discrete Frechet distance between two curves (returns only final value)
-    double discrete_frechet(const curves::Curve2d &p, const curves::Curve2d &q)
+    double **discrete_frechet_table(const curves::Curve2d &p, const curves::Curve2d &q)
     {
-        int pl = p.data.size();
-        int ql = q.data.size();
-
-        double **c = new double *[pl];
-
-        for (int i = 0; i < pl; i++)
-        {
-            c[i] = new double[ql];
-        }
-
-        // initialize 2d table for dynamic programming with value -1 (since distance cannot be negative)
-        for (int i = 0; i < pl; i++)
-        {
-            for (int j = 0; j < ql; j++)
-            {
-                c[i][j] = -1;
-            }
-        }
-
-        // base case
-        c[0][0] = L2(p.data[0].x, p.data[0].y, q.data[0].x, q.data[0].y);
-
-        // compute
-        compute_c(c, pl - 1, ql - 1, p.data, q.data);
-
-        double result = c[pl - 1][ql - 1];
-
-        for (int i = 0; i < pl; i++)
-        {
-            delete[] c[i];
-        }
-        delete[] c;
-
-        return result;
+        return discrete_frechet_table(p.data, q.data);
     }
 
-    // calculates discrete Frechet distance between only the data attribute of two curves (returns only final value)
-    double discrete_frechet_for_data(std::vector<curves::Point2d> &p, std::vector<curves::Point2d> &q)
+    // calculates discrete Frechet distance between two curves (returns only final value)
+    // only two rows of the dynamic programming table are kept, since each row depends only on the previous one
+    double discrete_frechet(const curves::CurveView &p, const curves::CurveView &q)
     {
         int pl = p.size();
         int ql = q.size();
 
-        double **c = new double *[pl];
+        std::vector<double> prev(ql);
+        std::vector<double> curr(ql);
 
-        for (int i = 0; i < pl; i++)
-        {
-            c[i] = new double[ql];
-        }
+        // first row
+        fill_row(nullptr, prev.data(), 0, p, q);
 
-        // initialize 2d table for dynamic programming with value -1 (since distance cannot be negative)
-        for (int i = 0; i < pl; i++)
+        // rest of the rows
+        for (int i = 1; i < pl; i++)
         {
-            for (int j = 0; j < ql; j++)
-            {
-                c[i][j] = -1;
-            }
+            fill_row(prev.data(), curr.data(), i, p, q);
+            prev.swap(curr);
         }
 
-        // base case
-        c[0][0] = L2(p[0].x, p[0].y, q[0].x, q[0].y);
-
-        // compute
-        compute_c(c, pl - 1, ql - 1, p, q);
-
-        double result = c[pl - 1][ql - 1];
+        return prev[ql - 1];
+    }
 
-        for (int i = 0; i < pl; i++)
-        {
-            delete[] c[i];
-        }
-        delete[] c;
+    double discrete_frechet(const curves::Curve2d &p, const curves::Curve2d &q)
+    {
+        return discrete_frechet(p.data, q.data);
+    }
 
-        return result;
+    // calculates discrete Frechet distance between only the data attribute of two curves (returns only final value)
+    double discrete_frechet_for_data(const curves::CurveView &p, const curves::CurveView &q)
+    {
+        return discrete_frechet(p, q);
     }
 
     // searches for the exact nearest neighbour of the query curve using brute force approach
     std::pair<curves::Curve2d *, double> search_exactNN(curves::Curve2d &query, vector<curves::Curve2d> &dataset)
     {
-        int size = query.data.size(); // length of curve
-
         // we will store current nearest neighbour in curr_NN along with its distance from query
-        vector<double> dummy_vec;
-        for (int i = 0; i < size; i++)
-            dummy_vec.push_back(0.0);
-        curves::Curve2d null_curve = curves::Curve2d("null", dummy_vec, dummy_vec);
+        static curves::Curve2d null_curve = curves::Curve2d("null"); // static, so that the returned pointer stays valid
         std::pair<curves::Curve2d *, double> curr_NN;
         curr_NN.first = &null_curve;
         curr_NN.second = std::numeric_limits<double>::max();
@@ -206,16 +204,24 @@ namespace dF
         return distance;
     }
 
+    // discrete Frechet distance of each center from its previous position
+    std::vector<double> centers_displacements(std::vector<vector<curves::Point2d>> &cur_centers, std::vector<vector<curves::Point2d>> &old_centers)
+    {
+        std::vector<double> displacements(cur_centers.size());
+        for (int i = 0; i < cur_centers.size(); i++)
+            displacements[i] = discrete_frechet_for_data(cur_centers[i], old_centers[i]);
+        return displacements;
+    }
+
     double max_centers_displacement(std::vector<vector<curves::Point2d>> &cur_centers, std::vector<vector<curves::Point2d>> &old_centers)
     {
         double max = 0.0;
-        double displacement = 0.0;
+        std::vector<double> displacements = centers_displacements(cur_centers, old_centers);
 
-        for(int i=0; i<cur_centers.size(); i++)
+        for(int i=0; i<displacements.size(); i++)
         {
-            displacement = discrete_frechet_for_data(cur_centers[i], old_centers[i]);
-            if(displacement > max)
-                max = displacement;
+            if(displacements[i] > max)
+                max = displacements[i];
         }
         return max;
     }
@@ -11,6 +11,7 @@
 #include <random>
 #include "./hashing.hpp"
 #include "../../includes/utils.hpp"
+#include "../../includes/range_rings.hpp"
 
 using namespace std;
 
@@ -269,57 +270,23 @@ public:
         return knns;
     }
 
-    // performs the Range Search algorithm using Hypercube randomized projection
-    std::vector<std::pair<double, Item *>> RangeSearch(Item *query, double radius)
+    // Range search whose radius can grow (see includes/range_rings.hpp): the unmarked items of the probes of the query, of which
+    // at most M are examined for every radius
+    RangeRings<Item> IncrementalRangeSearch(Item *query)
     {
-        // At first initalize the result vector of <distanceFromQuery, item> pairs
-        std::vector<std::pair<double, Item *>> rns;
+        std::vector<Item *> found;
         unsigned int q_bucket = find_bucket(*query);
-        // cout << "Query " << query.id << " is in bucket " << q_bucket << endl;
         vector<int> search_probes = get_probes_in_threshold(q_bucket);
-
-        // cout << "-----------------------------------------------------" << endl;
-        int items_searched = 0;
-        int curr_bucket;
         for (int i = 0; i < search_probes.size(); ++i)
         {
-            curr_bucket = search_probes[i];
-            // cout << "Searching bucket " << curr_bucket << " with " << hash_table[curr_bucket].size() << " items inside." << endl;
-            // cout << "BUCKET " << curr_bucket << ": ";
-            // for (int j = 0; j < hash_table[curr_bucket].size(); ++j)
-            // {
-            //     cout << hash_table[curr_bucket][j].id << ", ";
-            // }
-            // cout << endl;
-
+            int curr_bucket = search_probes[i];
             for (int j = 0; j < hash_table[curr_bucket].size(); ++j)
-            {
-                /* In the "reverse assignment with range search" clustering algorithm we mark items when they are
-                assigned to a cluster so the next range search doesn't check them. In ANN all items are unmarked so this
-                has no effect */
-                if (hash_table[curr_bucket][j]->marked == true)
-                    continue;
-
-                // cout << "Item " << hash_table[curr_bucket][j].id << " in ";
-                double dist = EuclideanDistance(query, hash_table[curr_bucket][j], d);
-                // cout << "distance " << dist << " | ";
-
-                if (dist < radius)
-                {
-                    std::pair<double, Item *> tmp_pair = std::make_pair(dist, hash_table[curr_bucket][j]);
-                    rns.push_back(tmp_pair);
-                }
-
-                items_searched++;
-                if (items_searched >= this->M)
-                {
-                    return rns;
-                }
-            }
-            // cout << endl;
-            // cout << "...................." << endl;
+                if (hash_table[curr_bucket][j]->marked == false)
+                    found.push_back(hash_table[curr_bucket][j]);
         }
-        return rns;
+        int dim = d;
+        return RangeRings<Item>(std::move(found), [query, dim](const Item *item)
+                                { return EuclideanDistance(query, item, dim); }, this->M);
     }
 };
 
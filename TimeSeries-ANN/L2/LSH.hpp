@@ -7,6 +7,7 @@
 #include <cmath>
 #include <random>
 #include "./hashing.hpp"
+#include "../../includes/range_rings.hpp"
 
 // class to hold parameters of LSH algorithm
 class LSH_params
@@ -45,18 +46,20 @@ public:
     };
 
     unsigned int produce_g(const Item &p)
+    {
+        return produce_g(p.xij.data(), p.xij.size());
+    }
+
+    // same as above for n coordinates straight from memory (used by LSH for curves to hash without building an Item)
+    unsigned int produce_g(const double *x, int n)
     {
         H h_familly = H(w, d, k);
-        vector<int> h = h_familly.produce_k_h(p);
-        // for (int j = 0; j < k; j++)
-        // {
-        //     cout << h[j] << ", ";
-        // }
-        // cout << endl;
 
         long unsigned int sum = 0;
         for (int i = 0; i < k; i++)
         {
+            int h = h_familly.produce_h(x, n);
+
             /*
             We are using the following formula to not achieve overflow:
             (a$b)modM = ((amodM)$(bmodM))modM.
@@ -66,7 +69,7 @@ public:
             long unsigned int amodm = (long unsigned)this->r[i] % m;
 
             // Calculate b mod M
-            long unsigned int bmodm = (long unsigned)h[i] % m;
+            long unsigned int bmodm = (long unsigned)h % m;
 
             // Calculate (amodM*bmodM)modM
             long unsigned int resmodm = (amodm * bmodm) % m;
@@ -221,56 +224,23 @@ public:
     }
 
     /*
-    Each neighbor is represented as a pair of <distanceToQuery, neighborItem*>
-    The following function returns a vector of these pairs
+    Range search whose radius can grow (see includes/range_rings.hpp): the unmarked items of the buckets of the query, each one
+    once, of which at most thresh are examined for every radius (thresh == 0 means no limit).
     */
-    std::vector<std::pair<double, Item *>> RangeSearch(const Item *query, double radius, int thresh = 0) const
+    RangeRings<Item> IncrementalRangeSearch(const Item *query, int thresh = 0) const
     {
-        std::vector<std::pair<double, Item *>> d;
-
-        // For each hash table...
-        int itemsSearched = 0;
+        std::vector<Item *> found;
         for (int i = 0; i < params.L; i++)
         {
-            // Calculate the bucket to which the query item corresponds
             long unsigned id = g[i]->produce_g(*query);
             long unsigned bucket = id % (long unsigned)tableSize;
-
-            // For each item inside the bucket...
             for (int j = 0; j < hashTables[i][bucket].size(); j++)
-            {
-                // Check if the current item is already inserted into the vector
-                bool alreadyExists = false;
-                for (int a = 0; a < d.size(); a++)
-                    if (d[a].second->id == hashTables[i][bucket][j]->id)
-                        alreadyExists = true;
-
-                /* In the "reverse assignment with range search using LSH" clustering algorithm we mark items when they are
-                assigned to a cluster so the next range search doesn't check them. In ANN all items are unmarked so this
-                has no effect */
-                if (alreadyExists || hashTables[i][bucket][j]->marked == true)
-                    continue;
-
-                double distance = EuclideanDistance(query, hashTables[i][bucket][j], dimension);
-
-                // If the distance is less than radius, insert the pair into the return vector
-                if (distance < radius)
-                {
-                    std::pair<double, Item *> tmpPair = std::make_pair(distance, hashTables[i][bucket][j]);
-                    d.push_back(tmpPair);
-                }
-
-                // If a certain threshold of items traversed is reached, return the vector.
-                itemsSearched++;
-                if (thresh != 0 && itemsSearched >= thresh)
-                {
-                    // std::sort(d.begin(), d.end(), comparePairs);
-                    return d;
-                }
-            }
+                if (hashTables[i][bucket][j]->marked == false)
+                    found.push_back(hashTables[i][bucket][j]);
         }
-        // std::sort(d.begin(), d.end(), comparePairs);
-        return d;
+        int dim = dimension;
+        return RangeRings<Item>(std::move(found), [query, dim](const Item *item)
+                                { return EuclideanDistance(query, item, dim); }, thresh);
     }
 };
 
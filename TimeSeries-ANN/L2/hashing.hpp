@@ -23,20 +23,29 @@ class H
 public:
     H(int window, int dimensions, int k) : w(window), d(dimensions), k(k), eng(chrono::system_clock::now().time_since_epoch().count()), nd(0, 1), urd(0, w){};
 
-    int produce_h(Item p)
+    int produce_h(const Item &p)
     {
-        vector<float> v;
-        // create a vector v whose points follow the normal distribution
+        return produce_h(p.xij.data(), p.xij.size());
+    }
+
+    /* Same as above for n coordinates straight from memory. The points of v (which follow the normal distribution) are drawn
+    one by one in the same order as before, so no vector has to be stored. The sum is kept in an int on purpose, to give the
+    same result as inner_product() with an int initial value did. */
+    int produce_h(const double *x, int n)
+    {
+        int sum = 0;
         for (int i = 0; i < d; i++)
         {
-            v.push_back(nd(eng));
+            float v = nd(eng);
+            if (i < n)
+                sum = sum + x[i] * v;
         }
 
         float t = urd(eng);
-        return floor(((inner_product(p.xij.begin(), p.xij.end(), v.begin(), 0)) + t) / this->w);
+        return floor((sum + t) / this->w);
     }
 
-    vector<int> produce_k_h(Item p)
+    vector<int> produce_k_h(const Item &p)
     {
         vector<int> h_vector;
         for (int i = 0; i < k; i++)
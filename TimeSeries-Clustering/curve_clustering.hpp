@@ -8,6 +8,11 @@
 #include <chrono>
 #include "../includes/utils.hpp"
 #include "../includes/mean_curve.hpp"
+#include "../includes/parallel.hpp"
+#include "../includes/seeding.hpp"
+#include "../includes/membership.hpp"
+#include "../includes/silhouette.hpp"
+#include "../includes/range_claims.hpp"
 #include "../TimeSeries-ANN/DiscreteFrechet/disc_Frechet.hpp"
 #include "../TimeSeries-ANN/DiscreteFrechet/discF_LSH.hpp"
 #include "../TimeSeries-ANN/L2/LSH.hpp"
@@ -28,57 +33,26 @@ namespace curve_cluster
 
         double mean_df;
 
-        std::default_random_engine eng; // an engine to help us pick first center randomnly
-        std::uniform_int_distribution<int> uid;
+        /* Bounds of the accelerated Lloyd's algorithm (Accelerated_Clustering()), as in Hamerly's k-means. upper[i] is an upper bound
+        of the discrete Frechet distance of curve i from its center and lower[i] a lower bound of its distance from every other center.
+        half_min_center_dist[a] is half the distance of center a from its closest other center: if a curve is closer than that to its
+        center, no other center can be closer to it. */
+        std::vector<double> upper;
+        std::vector<double> lower;
+        std::vector<double> half_min_center_dist;
+        long long distances_computed;
+        std::vector<long long> worker_distances; // distances computed by each worker of the current Bounded_assignment()
 
-        /* Calculates the Frechet distance of each point in dataset from its nearest centroid
-            Parameters are an std::vector containing the current centroids, and std::vector in which the min distance from nearest centroid
-            of each corresponding dataset item will be stored and a sum accumulator "dist_sum" of all those distances (needed for calculate_probs).*/
-        void calculate_min_dists(vector<double> &d, double &dist_sum)
-        {
-            double max_d = 0.0; // for normalization
-            // for each point in the dataset
-            for (int i = 0; i < this->dataset->size(); ++i)
-            {
-                // calculate Frechet distance from nearest centoid
-                double min_dist = dF::discrete_frechet_for_data(centers[0], (*dataset)[i].data);
-                if (min_dist > max_d)
-                {
-                    max_d = min_dist;
-                }
-                for (int cntr = 1; cntr < centers.size(); ++cntr)
-                {
-                    double dist = dF::discrete_frechet_for_data(centers[cntr], (*dataset)[i].data);
-                    if (dist > max_d)
-                        max_d = dist;
-                    if (dist < min_dist)
-                        min_dist = dist;
-                }
-                d[i] = min_dist;
-            }
-            // normalize data
-            for (int j = 0; j < d.size(); ++j)
-            {
-                d[j] = d[j] / max_d;
-            }
-            // calculate sum ΣD(i)^2
-            for (int i = 0; i < d.size(); ++i)
-            {
-                dist_sum += pow(d[i], 2.0);
-            }
-        }
+        // bounds are moved by computed (rounded) distances, so a center is only skipped when it loses by more than this relative margin
+        // (this way the accelerated algorithm gives exactly the assignments of Lloyds_assignment())
+        static constexpr double bound_slack = 1e-9;
 
-        /* Calculates probability of each point in dataset to be picked as next centroid.
-            Parameters are an std::vector containing all the corresponding distances of each point in the dataset
-            from its nearest centroid, a sum of all those distances and an std::vector in which the corresponding
-            probability of each point will be stored */
-        void calculate_probs(vector<double> d, double dist_sum, vector<double> &p)
-        {
-            for (int i = 0; i < d.size(); ++i)
-            {
-                p[i] = pow(d[i], 2.0) / dist_sum;
-            }
-        }
+        static bool surely_less(double a, double b) { return a * (1 + bound_slack) < b * (1 - bound_slack); }
+
+        RangeClaims claims; // claims of the balls in each round of the reverse assignment
+
+        std::default_random_engine eng; // an engine to help us pick first center randomnly
+        std::uniform_int_distribution<int> uid;
 
         // helper method that calculates starting radius for Reverse Assignment algorithms, which is min(dist between centers)/2
         double calculate_start_radius()
@@ -104,7 +78,8 @@ namespace curve_cluster
         public:
 
         vector<vector<curves::Point2d>> centers;
-        vector<vector<curves::Curve2d>> clusters;
+        Membership clusters; // indices (in dataset) of the curves of each cluster
+        silhouette::Report silhouettes; // averages of the last evaluate_silhouette() (evaluated is reset when the clusters change)
 
         Clustering(Cli::Cluster_params &params, std::vector<curves::Curve2d> * dataset) : params(params),
                                                                                 n_centers(params.clusters),
@@ -112,37 +87,21 @@ namespace curve_cluster
                                                                                 assignments_vec(dataset->size()),
                                                                                 dataset(dataset),
                                                                                 mean_df(dF::mean_df_between_curves(*dataset)),
+                                                                                claims(dataset->size()),
                                                                                 eng(chrono::system_clock::now().time_since_epoch().count()),
                                                                                 uid(0, dataset->size() - 1) {}
 
-        void initialize_pp()
+        /* Picks the initial centers with seeding::initial_centers(): k-means++ that only compares every item with the center added
+         last, or k-means|| if the configuration file gives it a positive number of rounds */
+        void initialize_centers()
         {
-            // pick first centroid at random
-            int rcentroid_index = this->uid(eng);
-            centers.push_back((*dataset)[rcentroid_index].data);
-
-            // continue by picking more centroids until we reach the given number
-            // centroids must be far away from each other
-            while (centers.size() < this->n_centers)
-            {
-                double dist_sum = 0.0;
-                std::vector<double> d(dataset->size(), 0.0); // distances of points to closest centroid
-                std::vector<double> p(dataset->size(), 0.0); // probabilities of points to be chosen as next centroid
-
-                this->calculate_min_dists(d, dist_sum); // calculate min distance of all points to the closest centroid for them
-
-                this->calculate_probs(d, dist_sum, p); // calculate probability of each point to be chosen as next centroid
-                double sum_prob = 0.0;
-                for (int k = 0; k < p.size(); ++k)
-                {
-                    sum_prob += p[k];
-                }
-
-                std::discrete_distribution<> distribution{p.begin(), p.end()};
-                int pick = distribution(eng);
-                centers.push_back((*dataset)[pick].data);
-            }
+            std::vector<int> chosen = seeding::initial_centers(this->dataset->size(), this->n_centers, [&](int i, int j)
+                                                                { return dF::discrete_frechet_for_data((*dataset)[i].data, (*dataset)[j].data); }, eng,
+                                                                params.seeding_rounds, params.oversampling);
+            for (int c = 0; c < chosen.size(); ++c)
+                centers.push_back((*dataset)[chosen[c]].data.points());
         }
+
         /* Assigns a nearest center to each point (part 1 of Lloyd's algorithm) using L2 distance.
          Stores both the current assignments and the current clusters in "assignments_vec" and "clusters" attributes respectively */
         void Lloyds_assignment()
@@ -152,7 +111,10 @@ namespace curve_cluster
             {
 
                 if ((*dataset)[i].marked) // if item is marked, it is assigned in a cluster during reverse_assignement
+                {
+                    this->assignments_vec[i] = (*dataset)[i].cluster;
                     continue;
+                }
 
                 double min_d = dF::discrete_frechet_for_data(this->centers[0], (*dataset)[i].data);
                 nearest_cntr = 0;
@@ -168,76 +130,158 @@ namespace curve_cluster
                 }
 
                 this->assignments_vec[i] = nearest_cntr;
-                this->clusters[nearest_cntr].push_back((*dataset)[i]); // push it into a cluster based on assigned center
                 (*dataset)[i].cluster = nearest_cntr;
             }
+            // group the curves by cluster
+            this->clusters.build(this->assignments_vec, this->centers.size());
+            this->silhouettes.evaluated = 0;
+        }
+
+        // half the discrete Frechet distance of each center from its closest other center
+        void compute_center_dists()
+        {
+            int K = this->centers.size();
+            vector<double> half_dists((size_t)K * K, 0.0);
+            parallel::for_each_task(K, [&](int a, int)
+            {
+                for (int c = a + 1; c < K; ++c)
+                    half_dists[(size_t)a * K + c] = dF::discrete_frechet_for_data(this->centers[a], this->centers[c]) / 2;
+            });
+            this->half_min_center_dist.assign(K, std::numeric_limits<double>::max());
+            for (int a = 0; a < K; ++a)
+                for (int c = a + 1; c < K; ++c)
+                {
+                    half_min_center_dist[a] = std::min(half_min_center_dist[a], half_dists[(size_t)a * K + c]);
+                    half_min_center_dist[c] = std::min(half_min_center_dist[c], half_dists[(size_t)a * K + c]);
+                }
+        }
+
+        /* Assignment step of the accelerated Lloyd's algorithm. The first time (initial == true) every distance is computed and the
+         bounds are set, afterwards the distances of a curve are only computed when its bounds (moved by update_bounds()) cannot keep
+         it in its cluster. Ties are broken in favour of the center with the smaller index, as in Lloyds_assignment() */
+        void Bounded_assignment(bool initial)
+        {
+            int K = this->centers.size();
+            this->compute_center_dists();
+            // every curve costs up to K discrete Frechet distances, so each one is a task of its own, and each worker counts the
+            // distances it computed (added to distances_computed once the assignment is over)
+            this->worker_distances.assign(parallel::workers(this->dataset->size()), 0);
+            parallel::for_each_task(this->dataset->size(), [&](int i, int worker)
+            {
+                curves::Curve2d &curve = (*dataset)[i];
+                int a = curve.cluster;
+                long long computed = 0;
+
+                if (!initial)
+                {
+                    double bound = std::max(half_min_center_dist[a], lower[i]);
+                    if (surely_less(upper[i], bound))
+                        return;
+                    // tighten the upper bound and try again
+                    upper[i] = dF::discrete_frechet_for_data(this->centers[a], curve.data);
+                    computed++;
+                    if (surely_less(upper[i], bound))
+                    {
+                        this->worker_distances[worker] += computed;
+                        return;
+                    }
+                }
+
+                // compare with every center, keeping the closest and the second closest distance
+                double best = std::numeric_limits<double>::max(), second = best;
+                for (int c = 0; c < K; ++c)
+                {
+                    double d = dF::discrete_frechet_for_data(this->centers[c], curve.data);
+                    if (d < best)
+                    {
+                        second = best;
+                        best = d;
+                        a = c;
+                    }
+                    else if (d < second)
+                        second = d;
+                }
+                computed += K;
+                upper[i] = best;
+                lower[i] = second;
+                curve.cluster = a;
+                this->assignments_vec[i] = a;
+                this->worker_distances[worker] += computed;
+            });
+            for (long long computed : this->worker_distances)
+                this->distances_computed += computed;
+
+            // build the clusters from the assignments (in the order of the dataset)
+            this->clusters.build(this->assignments_vec, K);
+            this->silhouettes.evaluated = 0;
+        }
+
+        // moves the bounds of the accelerated Lloyd's algorithm by how much each center moved (in discrete Frechet) during the update step
+        void update_bounds(vector<vector<curves::Point2d>> &old_centers)
+        {
+            int K = this->centers.size();
+            vector<double> shift = dF::centers_displacements(this->centers, old_centers);
+            int farthest = 0; // the center that moved the most
+            for (int c = 1; c < K; ++c)
+                if (shift[c] > shift[farthest])
+                    farthest = c;
+            double second_shift = 0.0; // the largest move of the other centers
+            for (int c = 0; c < K; ++c)
+                if (c != farthest && shift[c] > second_shift)
+                    second_shift = shift[c];
+
+            for (int i = 0; i < this->dataset->size(); ++i)
+            {
+                int a = this->assignments_vec[i];
+                upper[i] += shift[a];
+                // the second closest center is any center but a
+                lower[i] = std::max(0.0, lower[i] - (a == farthest ? second_shift : shift[farthest]));
+            }
         }
 
         /* Assigns a nearest center to each point by reverse LSH range search and discrete Frechet distance.
-         Expects a dFLSH::LSH object as parameter. */
+         Expects a dFLSH::LSH object as parameter. Curves that no ball found are assigned by Lloyds_assignment(). */
         void Range_dfLSH_assignment(dFLSH::LSH &dflsh)
         {
             int balls_changed = 0;
             double radius = calculate_start_radius();
             int iter = 0;
+            curves::Curve2d *first_curve = this->dataset->data();
+
+            // the candidates of every center and their distances are found once, each round only gets the ones of its new ring
+            std::vector<RangeRings<curves::Curve2d>> balls;
+            for (int c = 0; c < this->n_centers; ++c)
+                balls.push_back(dflsh.IncrementalRangeSearch(this->centers[c], 0));
 
-            unordered_map<string, pair<curves::Curve2d *, int>> step_assignments; // map item id string to a pair that indicates a temporary item-cluster assignment
             do
             {
                 balls_changed = 0;
+                this->claims.next_round();
                 for (int c = 0; c < this->n_centers; ++c)
                 {
-                    // perform LSH Range Search
-                    std::vector<std::pair<curves::Curve2d *, double>> r_search;
-                    r_search = dflsh.RangeSearch(this->centers[c], radius, 0);
+                    // the curves of the ring between the previous and the current radius
+                    std::vector<std::pair<double, curves::Curve2d *>> r_search = balls[c].grow(radius);
 
                     // if ball found new items
                     if (r_search.size() > 0)
                     {
                         balls_changed++;
                     }
-                    for (int i = 0; i < r_search.size(); ++i)
-                    {
-                        curves::Curve2d *item = r_search[i].first;
-                        if (item->claimed == false) // if item has not been claimed by a ball
-                        {
-                            item->claimed = true;
-
-                            step_assignments[item->id] = make_pair(item, c); // temp assignment of item to cluster of index c
-                        }
-                        else // else must resolve conflict
-                        {
-                            // if we are here the item has already been assigned to another cluster
-                            int assigned_cluster = step_assignments[item->id].second;
-
-                            double dist_to_assigned = dF::discrete_frechet_for_data(this->centers[assigned_cluster], (*item).data);
-
-                            double dist_to_curr = dF::discrete_frechet_for_data(this->centers[c], (*item).data);
-
-                            if (dist_to_curr < dist_to_assigned)
-                                step_assignments[item->id] = make_pair(item, c); // temp assignment of item to cluster of index c
-                        }
-                    }
-                    r_search.clear();
+                    // the closest center claims each curve, by the distances the range search computed (see RangeClaims)
+                    for (int i = 0; i < (int)r_search.size(); ++i)
+                        this->claims.claim(r_search[i].second - first_curve, c, r_search[i].first);
                 }
                 radius *= 2; // double the search radius
                 iter++;
 
-                for (auto x : step_assignments)
+                for (int i : this->claims.items())
                 {
-                    // get the closest cluster found
-                    int closest_cluster = x.second.second;
-                    // get the item
-                    curves::Curve2d *item = x.second.first;
-
-                    item->claimed = false;
+                    curves::Curve2d &item = first_curve[i];
                     // mark the item because it will be added in a cluster
-                    item->marked = true;
-                    // assign point to its closest cluster
-                    item->cluster = closest_cluster;
-                    clusters[closest_cluster].push_back(*item);
+                    item.marked = true;
+                    // assign point to its closest cluster (Lloyds_assignment() puts it in the cluster)
+                    item.cluster = this->claims.center_of(i);
                 }
-                step_assignments.clear();
 
             } while (balls_changed >= this->n_centers * 0.2 || iter < 5);
 
@@ -247,18 +291,24 @@ namespace curve_cluster
         // update step of clustering for curves by calculation of mean curve
         void update_centers()
         {
-            // we must calculate mean per cluster and make it the new center
-            for (int i = 0; i < centers.size(); ++i)
+            // we must calculate mean per cluster and make it the new center (clusters are independent, so in parallel)
+            parallel::for_each_task(centers.size(), [&](int i, int)
             {
-                centers[i] = mean_of_curves(clusters[i]);
-            }
+                // an empty cluster keeps its center
+                if (!clusters.empty(i))
+                {
+                    centers[i] = mean_of_curves(*dataset, clusters.begin(i), clusters.size(i));
+                    // keep the center at a bounded complexity, otherwise it grows with the size of its cluster
+                    cF::simplify_curve(centers[i], this->params.max_center_complexity);
+                }
+            });
         }
 
         void Classic_Clustering(int max_iter)
         {
             std::cout << "[PERFORMING CLUSTERING] " << std::endl;
             int iter = 1; // iterations
-            this->initialize_pp();
+            this->initialize_centers();
 
             this->Lloyds_assignment();
             this->update_centers();
@@ -277,11 +327,6 @@ namespace curve_cluster
             do
             {
                 last_assignments = this->assignments_vec;
-                for (int i = 0; i < this->clusters.size(); ++i)
-                {
-                    this->clusters[i].clear(); // clear clusters so we can reassign the items
-                }
-
                 this->Lloyds_assignment();
                 this->update_centers();
                 iter++;
@@ -303,6 +348,43 @@ namespace curve_cluster
             cout << "Lloyd's algorithm ended after " << iter << " iterations" << endl;
         }
 
+        /* Lloyd's algorithm with Hamerly's bounds: it gives the same assignments as Classic_Clustering() but skips the discrete Frechet
+         distances of a curve from the centers as long as the triangle inequality keeps it in its cluster, which is most of them once
+         the centers settle */
+        void Accelerated_Clustering(int max_iter)
+        {
+            std::cout << "[PERFORMING CLUSTERING] " << std::endl;
+            int n = this->dataset->size();
+            int iter = 1; // iterations
+            this->initialize_centers();
+
+            int K = this->centers.size();
+            this->upper.assign(n, 0.0);
+            this->lower.assign(n, 0.0);
+            this->distances_computed = 0;
+
+            this->Bounded_assignment(true);
+            vector<vector<curves::Point2d>> old_centers = this->centers;
+            this->update_centers();
+            this->update_bounds(old_centers);
+
+            vector<int> last_assignments(this->assignments_vec.size());
+            do
+            {
+                last_assignments = this->assignments_vec;
+                this->Bounded_assignment(false);
+                old_centers = this->centers;
+                this->update_centers();
+                this->update_bounds(old_centers);
+                iter++;
+                // iterate until assignments don't change or until we reach max_iter threshold
+            } while ((!equal(assignments_vec.begin(), assignments_vec.end(), last_assignments.begin())) && iter < max_iter);
+
+            cout << "............................................" << endl;
+            cout << "Lloyd's algorithm (Hamerly) ended after " << iter << " iterations, computing " << distances_computed << " of the "
+                 << (long long)iter * n * K << " curve to center distances" << endl;
+        }
+
         void Reverse_Assignment_LSH_Clustering(int max_iterations)
         {
             std::cout << "[PERFORMING CLUSTERING] " << std::endl;
@@ -313,7 +395,7 @@ namespace curve_cluster
 
             int iter = 1; // iterations
 
-            this->initialize_pp();
+            this->initialize_centers();
             Range_dfLSH_assignment(*dflsh_object);
             update_centers();
             vector<vector<curves::Point2d>> old_centers = this->centers;
@@ -330,8 +412,6 @@ namespace curve_cluster
 
             do
             {
-                for (int i = 0; i < this->clusters.size(); ++i)
-                    this->clusters[i].clear(); // clear clusters so we can reassign the items
                 for (int i = 0; i < dataset->size(); i++)
                     (*dataset)[i].marked = false;
                 Range_dfLSH_assignment(*dflsh_object);
@@ -356,95 +436,46 @@ namespace curve_cluster
             cout << "Reverse Assignment Cluestering ended after " << iter << " iterations" << endl;
         }
 
-        // Silhouette of object at index i
-        double silhouette(curves::Curve2d &curve)
+        /* Computes the silhouette of every item (or, with sample > 0, of about that many items spread over the clusters) once and in
+        parallel, and keeps the averages in silhouettes for eval_specific_cluster() and eval_clustering(). The neighbour of an item
+        is the cluster of its closest center among the other non empty clusters. */
+        void evaluate_silhouette(int sample = 0)
         {
-            vector<curves::Curve2d> *cluster = &(clusters[curve.cluster]); // find out at which cluster this item is assigned to
-
-            //  calculate a(i) = average distance of i to objects in same cluster
-            vector<double> distances;
-
-            for (int j = 0; j < (*cluster).size(); ++j)
+            this->silhouettes = silhouette::evaluate(this->clusters, sample, [&](int i, int own)
             {
-                double dist = dF::discrete_frechet(curve, (*cluster)[j]);
-                distances.push_back(dist);
-            }
-
-            double a = 0.0;
-            for (int j = 0; j < distances.size(); ++j)
-            {
-                a += distances[j] / (double)(distances.size());
-            }
-
-            // calculate b(i) = average distance of i to objects in next best (neighbor) cluster, i.e. cluster of 2nd closest centroid
-            // first find the index of the next best cluster
-            int best;
-            double best_dist = std::numeric_limits<double>::max();
-            for (int j = 0; j < this->centers.size(); ++j)
-            {
-                if (j != curve.cluster)
+                double best_dist = std::numeric_limits<double>::max();
+                int best = own;
+                for (int c = 0; c < this->centers.size(); ++c)
                 {
-                    double dist = dF::discrete_frechet_for_data(curve.data, this->centers[j]);
-                    if (dist < best_dist)
+                    if (c != own && !this->clusters.empty(c)) // an empty cluster has no items to compare with
                     {
-                        best_dist = dist;
-                        best = j;
+                        double dist = dF::discrete_frechet_for_data((*dataset)[i].data, this->centers[c]);
+                        if (dist < best_dist)
+                        {
+                            best_dist = dist;
+                            best = c;
+                        }
                     }
                 }
-            }
-
-            // now perform the calculations
-            distances.clear();
-            cluster = &(this->clusters[best]);
-            for (int j = 0; j < (*cluster).size(); ++j)
-            {
-                double dist = dF::discrete_frechet(curve, (*cluster)[j]);
-                distances.push_back(dist);
-            }
-            double b = 0.0;
-            for (int j = 0; j < distances.size(); ++j)
-            {
-                b += distances[j] / (double)(distances.size());
-            }
-
-            // find max between a(i) and b(i)
-            double max = a;
-            if (b > a)
-            {
-                max = b;
-            }
-
-            // finally calculate and return silhouette
-            return (b - a) / max;
+                return best; },
+                [&](int i, int j)
+                { return dF::discrete_frechet((*dataset)[i], (*dataset)[j]); }, eng);
         }
 
         // metric to evaluate specific cluster (c_index = the index of said cluster)
         double eval_specific_cluster(int c_index)
         {
-            // cout << "Evaluating cluster: " << c_index << endl;
-            double average = 0.0;
-            double s = 0.0;
-            int n = this->clusters[c_index].size();
-            for (int i = 0; i < n; i++)
-            {
-                s = silhouette(clusters[c_index][i]);
-                average += s / (double)n;
-            }
-            return average;
+            if (this->silhouettes.evaluated == 0)
+                evaluate_silhouette();
+            return this->silhouettes.cluster_average[c_index];
         }
 
         // metric to evaluate overall clustering
         double eval_clustering()
         {
-            double average = 0.0;
-            double s = 0.0;
-            int n = this->dataset->size();
-            for (int i = 0; i < n; ++i)
-            {
-                s = silhouette((*dataset)[i]);
-                average += s / (double)n;
-            }
-            return s;
+            if (this->silhouettes.evaluated == 0)
+                evaluate_silhouette();
+            return this->silhouettes.average;
         }
 
     };
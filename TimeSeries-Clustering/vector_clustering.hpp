@@ -7,6 +7,11 @@
 #include <random>
 #include <chrono>
 #include "../includes/utils.hpp"
+#include "../includes/parallel.hpp"
+#include "../includes/seeding.hpp"
+#include "../includes/membership.hpp"
+#include "../includes/silhouette.hpp"
+#include "../includes/range_claims.hpp"
 #include "../TimeSeries-ANN/L2/LSH.hpp"
 #include "../TimeSeries-ANN/L2/HC.hpp"
 #include "../ui/Clustering_interface.hpp"
@@ -23,58 +28,41 @@ namespace vector_cluster
         std::vector<int> assignments_vec;     // shows the cluster to which each curve is assigned to
                                               // (example: if assignments[4]=2 then curve at index 4 of dataset is assigned to cluster at index 2)
 
+        // running sum of the vectors of each cluster (sums, n_centers x dimensions) and their number (counts). After the first
+        // assignment they are only corrected by the items that changed cluster, so update_centers() just divides them
+        std::vector<double> sums;
+        std::vector<int> counts;
+        bool sums_valid = false; // false until sums and counts hold the clusters of assignments_vec
+        std::vector<long long> chunk_counts; // what nearest() counted in each chunk of the last assign_in_chunks()
+        // scratch space of assign_in_chunks(), kept between assignments so that their capacity is reused: the moves of each chunk
+        // and the items that left and joined each cluster
+        std::vector<std::vector<std::pair<int, int>>> moves;
+        std::vector<std::vector<int>> left;
+        std::vector<std::vector<int>> joined;
+
+        /* Bounds of the accelerated Lloyd's algorithm (Accelerated_Clustering()). upper[i] is an upper bound of the distance of
+        item i from its center. Hamerly keeps a single lower bound per item (of the distance from its second closest center), while
+        Elkan keeps one per item and center (lower[i * n_centers + c]). half_center_dists[a * n_centers + c] is half the distance
+        between centers a and c and half_min_center_dist[a] half the distance of a from its closest other center: if an item is
+        closer than that to its center, no other center can be closer to it. */
+        bool elkan = false;
+        std::vector<double> upper;
+        std::vector<double> lower;
+        std::vector<double> half_center_dists;
+        std::vector<double> half_min_center_dist;
+        long long distances_computed;
+
+        // bounds are moved by computed (rounded) distances, so a center is only skipped when it loses by more than this relative margin
+        // (this way the accelerated algorithm gives exactly the assignments of Lloyds_assignment())
+        static constexpr double bound_slack = 1e-9;
+
+        static bool surely_less(double a, double b) { return a * (1 + bound_slack) < b * (1 - bound_slack); }
+
+        RangeClaims claims; // claims of the balls in each round of the reverse assignments
+
         std::default_random_engine eng; // an engine to help us pick first center randomnly
         std::uniform_int_distribution<int> uid;
 
-        /* Calculates the Frechet distance of each point in dataset from its nearest centroid
-            Parameters are an std::vector containing the current centroids, and std::vector in which the min distance from nearest centroid
-            of each corresponding dataset item will be stored and a sum accumulator "dist_sum" of all those distances (needed for calculate_probs).*/
-        void calculate_min_dists(vector<double> &d, double &dist_sum)
-        {
-            double max_d = 0.0; // for normalization
-            // for each point in the dataset
-            for (int i = 0; i < this->dataset->size(); ++i)
-            {
-                // calculate Frechet distance from nearest centoid
-                double min_dist = EuclideanDistance(&centers[0], &(*dataset)[i], this->dimensions);
-                if (min_dist > max_d)
-                {
-                    max_d = min_dist;
-                }
-                for (int cntr = 1; cntr < centers.size(); ++cntr)
-                {
-                    double dist = EuclideanDistance(&centers[cntr], &(*dataset)[i], this->dimensions);
-                    if (dist > max_d)
-                        max_d = dist;
-                    if (dist < min_dist)
-                        min_dist = dist;
-                }
-                d[i] = min_dist;
-            }
-            // normalize data
-            for (int j = 0; j < d.size(); ++j)
-            {
-                d[j] = d[j] / max_d;
-            }
-            // calculate sum ΣD(i)^2
-            for (int i = 0; i < d.size(); ++i)
-            {
-                dist_sum += pow(d[i], 2.0);
-            }
-        }
-
-        /* Calculates probability of each point in dataset to be picked as next centroid.
-            Parameters are an std::vector containing all the corresponding distances of each point in the dataset
-            from its nearest centroid, a sum of all those distances and an std::vector in which the corresponding
-            probability of each point will be stored */
-        void calculate_probs(vector<double> d, double dist_sum, vector<double> &p)
-        {
-            for (int i = 0; i < d.size(); ++i)
-            {
-                p[i] = pow(d[i], 2.0) / dist_sum;
-            }
-        }
-
         // helper method that calculates starting radius for Reverse Assignment algorithms, which is min(dist between centers)/2
         double calculate_start_radius()
         {
@@ -99,233 +87,354 @@ namespace vector_cluster
         public:
 
         vector<Item> centers;
-        vector<vector<Item>> clusters;
+        Membership clusters; // indices (in dataset) of the items of each cluster
+        silhouette::Report silhouettes; // averages of the last evaluate_silhouette() (evaluated is reset when the clusters change)
+        vector<int> streamed_sizes;          // number of items of each cluster when MiniBatch_Clustering() streamed the dataset file
+        vector<vector<string>> streamed_ids; // and their ids, only kept with -complete (the output lists them)
 
         Clustering(Cli::Cluster_params &params, std::vector<Item> * dataset) : params(params),
-                                                                                dimensions(dataset[0].size()),
+                                                                                dimensions((*dataset)[0].xij.size()),
                                                                                 n_centers(params.clusters),
                                                                                 clusters(params.clusters),
                                                                                 assignments_vec(dataset->size()),
                                                                                 dataset(dataset),
+                                                                                claims(dataset->size()),
                                                                                 eng(chrono::system_clock::now().time_since_epoch().count()),
                                                                                 uid(0, dataset->size() - 1) {}
 
-        void initialize_pp()
+        /* Picks the initial centers with seeding::initial_centers(): k-means++ that only compares every item with the center added
+         last, or k-means|| if the configuration file gives it a positive number of rounds */
+        void initialize_centers()
         {
-            // pick first centroid at random
-            int rcentroid_index = this->uid(eng);
-            centers.push_back((*dataset)[rcentroid_index]);
+            std::vector<int> chosen = seeding::initial_centers(this->dataset->size(), this->n_centers, [&](int i, int j)
+                                                                { return EuclideanDistance(&(*dataset)[i], &(*dataset)[j], this->dimensions); }, eng,
+                                                                params.seeding_rounds, params.oversampling);
+            for (int c = 0; c < chosen.size(); ++c)
+                centers.push_back((*dataset)[chosen[c]]);
+        }
 
-            // continue by picking more centroids until we reach the given number
-            // centroids must be far away from each other
-            while (centers.size() < this->n_centers)
+        /* Splits the dataset in chunks that are assigned in parallel: nearest(i, count) returns the cluster of item i and may add to
+         count (e.g. the distances it computed), which is kept per chunk and returned summed over all chunks. Stores both the
+         assignments and the clusters in "assignments_vec" and "clusters" attributes respectively and keeps the running sums of
+         the clusters up to date: only the items that changed cluster are subtracted from their old sum and added to the new one */
+        template <typename Nearest>
+        long long assign_in_chunks(Nearest nearest)
+        {
+            int n = this->dataset->size();
+            int K = this->centers.size();
+            int n_chunks = std::max(1, std::min(parallel::threads(), n / 256));
+            int chunk_size = (n + n_chunks - 1) / n_chunks;
+            // (item, previous cluster) of the items that changed cluster, per chunk (cleared, so their capacity is reused)
+            this->moves.resize(n_chunks);
+            for (auto &chunk_moves : this->moves)
+                chunk_moves.clear();
+            this->chunk_counts.assign(n_chunks, 0);
+
+            parallel::for_each_task(n_chunks, [&](int chunk, int)
             {
-                double dist_sum = 0.0;
-                std::vector<double> d(dataset->size(), 0.0); // distances of points to closest centroid
-                std::vector<double> p(dataset->size(), 0.0); // probabilities of points to be chosen as next centroid
+                int last = std::min(n, (chunk + 1) * chunk_size);
+                long long count = 0; // local to the chunk, written back once
+                for (int i = chunk * chunk_size; i < last; ++i)
+                {
+                    Item &item = (*dataset)[i];
+                    int previous = this->assignments_vec[i];
+                    int nearest_cntr = nearest(i, count);
+                    item.cluster = nearest_cntr;
+                    this->assignments_vec[i] = nearest_cntr;
+                    if (nearest_cntr != previous)
+                        this->moves[chunk].push_back(make_pair(i, previous));
+                }
+                this->chunk_counts[chunk] = count;
+            });
+            long long total = 0;
+            for (int chunk = 0; chunk < n_chunks; ++chunk)
+                total += this->chunk_counts[chunk];
 
-                this->calculate_min_dists(d, dist_sum); // calculate min distance of all points to the closest centroid for them
+            // build the clusters from the assignments (in the order of the dataset)
+            this->clusters.build(this->assignments_vec, K);
+            this->silhouettes.evaluated = 0;
 
-                this->calculate_probs(d, dist_sum, p); // calculate probability of each point to be chosen as next centroid
-                double sum_prob = 0.0;
-                for (int k = 0; k < p.size(); ++k)
+            if (!this->sums_valid)
+            {
+                // first assignment: sum every cluster (clusters are independent, so in parallel)
+                this->sums.assign((size_t)K * dimensions, 0.0);
+                this->counts.assign(K, 0);
+                parallel::for_each_task(K, [&](int c, int)
                 {
-                    sum_prob += p[k];
-                }
+                    double *sum = &this->sums[(size_t)c * dimensions];
+                    for (const int *i = this->clusters.begin(c); i != this->clusters.end(c); ++i)
+                        for (int d = 0; d < dimensions; ++d)
+                            sum[d] += (*dataset)[*i].xij[d];
+                    this->counts[c] = this->clusters.size(c);
+                });
+                this->sums_valid = true;
+                return total;
+            }
 
-                std::discrete_distribution<> distribution{p.begin(), p.end()};
-                int pick = distribution(eng);
-                centers.push_back((*dataset)[pick]);
+            // the items that left and joined each cluster, in the order of the dataset
+            this->left.resize(K);
+            this->joined.resize(K);
+            for (int c = 0; c < K; ++c)
+            {
+                this->left[c].clear();
+                this->joined[c].clear();
             }
+            for (int chunk = 0; chunk < n_chunks; ++chunk)
+                for (auto &move : this->moves[chunk])
+                {
+                    this->left[move.second].push_back(move.first);
+                    this->joined[this->assignments_vec[move.first]].push_back(move.first);
+                }
+            parallel::for_each_task(K, [&](int c, int)
+            {
+                double *sum = &this->sums[(size_t)c * dimensions];
+                for (int i : this->left[c])
+                    for (int d = 0; d < dimensions; ++d)
+                        sum[d] -= (*dataset)[i].xij[d];
+                for (int i : this->joined[c])
+                    for (int d = 0; d < dimensions; ++d)
+                        sum[d] += (*dataset)[i].xij[d];
+                this->counts[c] += (int)this->joined[c].size() - (int)this->left[c].size();
+            });
+            return total;
         }
+
         /* Assigns a nearest center to each point (part 1 of Lloyd's algorithm) using L2 distance.
-         Stores both the current assignments and the current clusters in "assignments_vec" and "clusters" attributes respectively */
+         Items already assigned by a reverse assignment (marked) keep their cluster. */
         void Lloyds_assignment()
         {
-            int nearest_cntr;
-            for (int i = 0; i < this->dataset->size(); ++i)
+            this->assign_in_chunks([&](int i, long long &count)
             {
+                Item &item = (*dataset)[i];
+                if (item.marked) // if item is marked, it is assigned in a cluster during reverse_assignement
+                    return item.cluster;
 
-                if ((*dataset)[i].marked) // if item is marked, it is assigned in a cluster during reverse_assignement
-                    continue;
-
-                double min_d = EuclideanDistance(&(centers[0]), &((*dataset)[i]), this->dimensions);
-                nearest_cntr = 0;
+                double min_d = EuclideanDistance(&(centers[0]), &item, this->dimensions);
+                int nearest_cntr = 0;
 
                 for (int c = 1; c < centers.size(); ++c)
                 {
-                    double next_d = EuclideanDistance(&centers[c], &((*dataset)[i]), this->dimensions);
+                    double next_d = EuclideanDistance(&centers[c], &item, this->dimensions);
                     if (next_d < min_d)
                     {
                         min_d = next_d;
                         nearest_cntr = c;
                     }
                 }
-
-                this->assignments_vec[i] = nearest_cntr;
-                this->clusters[nearest_cntr].push_back((*dataset)[i]); // push it into a cluster based on assigned center
-                (*dataset)[i].cluster = nearest_cntr;
-            }
+                return nearest_cntr;
+            });
         }
 
-        /* Assigns a nearest center to each point by reverse LSH range search and discrete Frechet distance.
-         Expects a dFLSH::LSH object as parameter. */
-        void Range_LSH_assignment(LSH &lsh)
+        // half distances between all pairs of centers, and of each center from its closest other center
+        void compute_center_dists()
         {
-            int balls_changed = 0;
-            double radius = calculate_start_radius();
-            int iter = 0;
-
-            unordered_map<string, pair<Item *, int>> step_assignments; // map item id string to a pair that indicates a temporary item-cluster assignment
-            do
+            int K = this->centers.size();
+            this->half_center_dists.assign((size_t)K * K, 0.0);
+            this->half_min_center_dist.assign(K, std::numeric_limits<double>::max());
+            parallel::for_each_task(K, [&](int a, int)
             {
-                balls_changed = 0;
-                for (int c = 0; c < this->n_centers; ++c)
+                for (int c = 0; c < K; ++c)
                 {
-                    // perform LSH Range Search
-                    std::vector<std::pair<double, Item *>> r_search;
-                    r_search = lsh.RangeSearch(&this->centers[c], radius, 0);
+                    if (c == a)
+                        continue;
+                    double half = EuclideanDistance(&centers[a], &centers[c], this->dimensions) / 2;
+                    half_center_dists[(size_t)a * K + c] = half;
+                    if (half < half_min_center_dist[a])
+                        half_min_center_dist[a] = half;
+                }
+            });
+        }
 
-                    // if ball found new items
-                    if (r_search.size() > 0)
+        /* Assignment step of the accelerated Lloyd's algorithm. The first time (initial == true) every distance is computed and the
+         bounds are set, afterwards a distance is only computed when the bounds (moved by update_bounds()) cannot rule a center out.
+         Ties are broken in favour of the center with the smaller index, as in Lloyds_assignment() */
+        void Bounded_assignment(bool initial)
+        {
+            int K = this->centers.size();
+            this->compute_center_dists();
+            this->distances_computed += this->assign_in_chunks([&](int i, long long &computed)
+            {
+                Item &item = (*dataset)[i];
+                int a = item.cluster;
+
+                if (initial || (!elkan && !surely_less(upper[i], std::max(half_min_center_dist[a], lower[i]))))
+                {
+                    if (!initial)
                     {
-                        balls_changed++;
+                        // tighten the upper bound and try again
+                        upper[i] = EuclideanDistance(&centers[a], &item, this->dimensions);
+                        computed++;
                     }
-                    for (int i = 0; i < r_search.size(); ++i)
+                    if (initial || !surely_less(upper[i], std::max(half_min_center_dist[a], lower[i])))
                     {
-                        Item *item = r_search[i].second;
-                        if (item->claimed == false) // if item has not been claimed by a ball
+                        // compare with every center, keeping the closest and (for Hamerly) the second closest distance
+                        double best = std::numeric_limits<double>::max(), second = best;
+                        for (int c = 0; c < K; ++c)
                         {
-                            item->claimed = true;
-
-                            step_assignments[item->id] = make_pair(item, c); // temp assignment of item to cluster of index c
+                            double d = EuclideanDistance(&centers[c], &item, this->dimensions);
+                            if (elkan)
+                                lower[(size_t)i * K + c] = d;
+                            if (d < best)
+                            {
+                                second = best;
+                                best = d;
+                                a = c;
+                            }
+                            else if (d < second)
+                                second = d;
                         }
-                        else // else must resolve conflict
+                        computed += K;
+                        upper[i] = best;
+                        if (!elkan)
+                            lower[i] = second;
+                    }
+                }
+                else if (elkan && !surely_less(upper[i], half_min_center_dist[a]))
+                {
+                    double *l = &lower[(size_t)i * K];
+                    bool tight = false;
+                    for (int c = 0; c < K; ++c)
+                    {
+                        if (c == a)
+                            continue;
+                        double z = std::max(l[c], half_center_dists[(size_t)a * K + c]);
+                        if (surely_less(upper[i], z))
+                            continue;
+                        if (!tight)
                         {
-                            // if we are here the item has already been assigned to another cluster
-                            int assigned_cluster = step_assignments[item->id].second;
-
-                            double dist_to_assigned = EuclideanDistance(&centers[assigned_cluster], item, this->dimensions);
-
-                            double dist_to_curr = EuclideanDistance(&centers[c], item, this->dimensions);
-
-                            if (dist_to_curr < dist_to_assigned)
-                                step_assignments[item->id] = make_pair(item, c); // temp assignment of item to cluster of index c
+                            upper[i] = l[a] = EuclideanDistance(&centers[a], &item, this->dimensions);
+                            computed++;
+                            tight = true;
+                            if (surely_less(upper[i], z))
+                                continue;
+                        }
+                        double d = l[c] = EuclideanDistance(&centers[c], &item, this->dimensions);
+                        computed++;
+                        if (d < upper[i] || (d == upper[i] && c < a))
+                        {
+                            a = c;
+                            upper[i] = d;
                         }
                     }
-                    r_search.clear();
                 }
-                radius *= 2; // double the search radius
-                iter++;
+                return a;
+            });
+        }
 
-                for (auto x : step_assignments)
-                {
-                    // get the closest cluster found
-                    int closest_cluster = x.second.second;
-                    // get the item
-                    Item *item = x.second.first;
+        // moves the bounds of the accelerated Lloyd's algorithm by how much each center moved during the update step
+        void update_bounds(const vector<Item> &old_centers)
+        {
+            int n = this->dataset->size();
+            int K = this->centers.size();
+            vector<double> shift(K);
+            int farthest = 0; // the center that moved the most
+            for (int c = 0; c < K; ++c)
+            {
+                shift[c] = EuclideanDistance(&old_centers[c], &centers[c], this->dimensions);
+                if (shift[c] > shift[farthest])
+                    farthest = c;
+            }
+            double second_shift = 0.0; // the largest move of the other centers
+            for (int c = 0; c < K; ++c)
+                if (c != farthest && shift[c] > second_shift)
+                    second_shift = shift[c];
 
-                    item->claimed = false;
-                    // mark the item because it will be added in a cluster
-                    item->marked = true;
-                    // assign point to its closest cluster
-                    item->cluster = closest_cluster;
-                    clusters[closest_cluster].push_back(*item);
+            int n_parts = parallel::chunks(n, 1024);
+            parallel::for_each_task(n_parts, [&](int part, int)
+            {
+                int first = (int)((long long)n * part / n_parts), last = (int)((long long)n * (part + 1) / n_parts);
+                for (int i = first; i < last; ++i)
+                {
+                    int a = this->assignments_vec[i];
+                    upper[i] += shift[a];
+                    if (elkan)
+                    {
+                        double *l = &lower[(size_t)i * K];
+                        for (int c = 0; c < K; ++c)
+                            l[c] = std::max(0.0, l[c] - shift[c]);
+                    }
+                    else // the second closest center is any center but a
+                        lower[i] = std::max(0.0, lower[i] - (a == farthest ? second_shift : shift[farthest]));
                 }
-                step_assignments.clear();
-
-            } while (balls_changed >= this->n_centers * 0.2 || iter < 5);
-
-            this->Lloyds_assignment();
+            });
         }
 
-        void Range_HC_assignment(Hypercube &hc)
+        /* Reverse assignment: balls around the centers, whose radius doubles every round, claim the items found around them.
+        rings(c) is the incremental range search of center c (see includes/range_rings.hpp), so every round only gets the items of
+        the ring between the previous and the new radius, with the distances computed once when the search was set up. An item
+        found by more than one ball goes to the closest of their centers and is marked so that the next rounds skip it. The
+        remaining items are assigned by Lloyds_assignment(). */
+        template <typename Rings>
+        void Range_assignment(Rings rings)
         {
             int balls_changed = 0;
             double radius = calculate_start_radius();
             int iter = 0;
+            Item *first_item = this->dataset->data();
+
+            std::vector<RangeRings<Item>> balls;
+            for (int c = 0; c < this->n_centers; ++c)
+                balls.push_back(rings(c));
 
-            unordered_map<string, pair<Item *, int>> step_assignments; // map item id string to a pair that indicates a temporary item-cluster assignment
             do
             {
                 balls_changed = 0;
+                this->claims.next_round();
                 for (int c = 0; c < this->n_centers; ++c)
                 {
-                    // perform Hypercube Range Search
-                    std::vector<std::pair<double, Item *>> r_search;
-                    r_search = hc.RangeSearch(&this->centers[c], radius);
+                    std::vector<std::pair<double, Item *>> r_search = balls[c].grow(radius);
 
                     // if ball found new items
                     if (r_search.size() > 0)
                     {
                         balls_changed++;
                     }
-                    for (int i = 0; i < r_search.size(); ++i)
-                    {
-                        Item *item = r_search[i].second;
-                        if (item->claimed == false) // if item has not been claimed by a ball
-                        {
-                            item->claimed = true;
-
-                            step_assignments[item->id] = make_pair(item, c); // temp assignment of item to cluster of index c
-                        }
-                        else // else must resolve conflict
-                        {
-                            // if we are here the item has already been assigned to another cluster
-                            int assigned_cluster = step_assignments[item->id].second;
-
-                            double dist_to_assigned = EuclideanDistance(&centers[assigned_cluster], item, this->dimensions);
-
-                            double dist_to_curr = EuclideanDistance(&centers[c], item, this->dimensions);
-
-                            if (dist_to_curr < dist_to_assigned)
-                                step_assignments[item->id] = make_pair(item, c); // temp assignment of item to cluster of index c
-                        }
-                    }
-                    r_search.clear();
+                    for (int i = 0; i < (int)r_search.size(); ++i)
+                        this->claims.claim(r_search[i].second - first_item, c, r_search[i].first);
                 }
                 radius *= 2; // double the search radius
                 iter++;
 
-                for (auto x : step_assignments)
+                for (int i : this->claims.items())
                 {
-                    // get the closest cluster found
-                    int closest_cluster = x.second.second;
-                    // get the item
-                    Item *item = x.second.first;
-
-                    item->claimed = false;
+                    Item &item = first_item[i];
                     // mark the item because it will be added in a cluster
-                    item->marked = true;
-                    // assign point to its closest cluster
-                    item->cluster = closest_cluster;
-                    clusters[closest_cluster].push_back(*item);
+                    item.marked = true;
+                    // assign point to its closest cluster (Lloyds_assignment() puts it in the cluster)
+                    item.cluster = this->claims.center_of(i);
                 }
-                step_assignments.clear();
 
             } while (balls_changed >= this->n_centers * 0.2 || iter < 5);
 
             this->Lloyds_assignment();
         }
 
-        
+        // assigns a nearest center to each point by reverse LSH range search
+        void Range_LSH_assignment(LSH &lsh)
+        {
+            this->Range_assignment([&](int c)
+                                   { return lsh.IncrementalRangeSearch(&this->centers[c], 0); });
+        }
+
+        // assigns a nearest center to each point by reverse Hypercube range search
+        void Range_HC_assignment(Hypercube &hc)
+        {
+            this->Range_assignment([&](int c)
+                                   { return hc.IncrementalRangeSearch(&this->centers[c]); });
+        }
 
-        // update step of clustering for curves by calculation of mean curve
+        // update step of clustering for vectors: the mean of each cluster, from its running sum (no allocations, O(K * dimensions))
         void update_centers()
         {
-            // we must calculate mean per cluster and make it the new center
             for (int i = 0; i < centers.size(); ++i)
             {
-                vector<double> mean(this->dimensions, 0.0);
-                int T = clusters[i].size(); // number of objects in cluster
-
-                // calculate mean
-                for (int j = 0; j < T; ++j)
-                {
-                    mean = vector_mean(mean, clusters[i][j].xij, dimensions, T);
-                }
-
-                centers[i].xij = mean;
+                // an empty cluster keeps its center
+                if (this->counts[i] == 0)
+                    continue;
+                const double *sum = &this->sums[(size_t)i * dimensions];
+                vector<double> &mean = centers[i].xij;
+                for (int d = 0; d < dimensions; ++d)
+                    mean[d] = sum[d] / this->counts[i];
             }
         }
 
@@ -333,7 +442,7 @@ namespace vector_cluster
         {
             std::cout << "[PERFORMING CLUSTERING] " << std::endl;
             int iter = 1; // iterations
-            this->initialize_pp();
+            this->initialize_centers();
 
             this->Lloyds_assignment();
             this->update_centers();
@@ -352,11 +461,6 @@ namespace vector_cluster
             do
             {
                 last_assignments = this->assignments_vec;
-                for (int i = 0; i < this->clusters.size(); ++i)
-                {
-                    this->clusters[i].clear(); // clear clusters so we can reassign the items
-                }
-
                 this->Lloyds_assignment();
                 this->update_centers();
                 iter++;
@@ -378,6 +482,202 @@ namespace vector_cluster
             cout << "Lloyd's algorithm ended after " << iter << " iterations" << endl;
         }
 
+        /* Lloyd's algorithm accelerated by the triangle inequality: it gives the same assignments as Classic_Clustering() but skips
+         most point to center distances once the centers settle. Hamerly's bounds (one lower bound per item) are used for a few clusters
+         and Elkan's (one lower bound per item and cluster) for many, where they rule out far more centers */
+        void Accelerated_Clustering(int max_iter)
+        {
+            std::cout << "[PERFORMING CLUSTERING] " << std::endl;
+            int n = this->dataset->size();
+            int iter = 1; // iterations
+            this->initialize_centers();
+
+            int K = this->centers.size();
+            this->elkan = K >= 32;
+            this->upper.assign(n, 0.0);
+            this->lower.assign(elkan ? (size_t)n * K : n, 0.0);
+            this->distances_computed = 0;
+
+            this->Bounded_assignment(true);
+            vector<Item> old_centers = this->centers;
+            this->update_centers();
+            this->update_bounds(old_centers);
+
+            vector<int> last_assignments(this->assignments_vec.size());
+            do
+            {
+                last_assignments = this->assignments_vec;
+                this->Bounded_assignment(false);
+                old_centers = this->centers;
+                this->update_centers();
+                this->update_bounds(old_centers);
+                iter++;
+                // iterate until assignments don't change or until we reach max_iter threshold
+            } while ((!equal(assignments_vec.begin(), assignments_vec.end(), last_assignments.begin())) && iter < max_iter);
+
+            cout << "............................................" << endl;
+            cout << "Lloyd's algorithm (" << (elkan ? "Elkan" : "Hamerly") << ") ended after " << iter << " iterations, computing "
+                 << distances_computed << " of the " << (long long)iter * n * K << " point to center distances" << endl;
+        }
+
+        // nearest center (and its distance) of each of the b items of a batch, the items are split among the threads
+        void nearest_centers(vector<Item *> &batch, int b, vector<int> &nearest, vector<double> &nearest_dist)
+        {
+            int n_parts = parallel::chunks(b, 64);
+            parallel::for_each_task(n_parts, [&](int part, int)
+            {
+                int first = (int)((long long)b * part / n_parts), last = (int)((long long)b * (part + 1) / n_parts);
+                for (int j = first; j < last; ++j)
+                {
+                    double min_d = EuclideanDistance(&centers[0], batch[j], this->dimensions);
+                    nearest[j] = 0;
+                    for (int c = 1; c < centers.size(); ++c)
+                    {
+                        double d = EuclideanDistance(&centers[c], batch[j], this->dimensions);
+                        if (d < min_d)
+                        {
+                            min_d = d;
+                            nearest[j] = c;
+                        }
+                    }
+                    nearest_dist[j] = min_d;
+                }
+            });
+        }
+
+        /* Mini-batch k-means (Sculley, "Web-scale k-means clustering"). Each step assigns a batch of batch_size vectors to their
+         nearest centers and moves each center towards its vectors with a learning rate of 1 / (number of vectors it got so far),
+         so the centers settle within a bounded number of passes over the dataset. Batches are sampled at random from the dataset or,
+         if a stream is given, read one after the other from the file (the dataset then only holds a sample of the file, used for the
+         initialization). Stops after max_passes passes or, after the first pass, when the smoothed inertia of the batches has not
+         improved for 10 steps. */
+        void MiniBatch_Clustering(int batch_size, int max_passes, ItemStream *stream = nullptr)
+        {
+            std::cout << "[PERFORMING CLUSTERING] " << std::endl;
+            this->initialize_centers();
+
+            int K = this->centers.size();
+            batch_size = std::max(1, batch_size);
+            vector<long long> center_counts(K, 0);          // vectors each center got so far
+            vector<Item> batch_buffer(stream ? batch_size : 0); // the batch read from the stream
+            vector<Item *> batch(batch_size);
+            vector<int> nearest(batch_size);
+            vector<double> nearest_dist(batch_size);
+            vector<vector<int>> members(K);                  // positions in the batch of the vectors of each center
+
+            long long n = stream ? 0 : this->dataset->size(); // number of vectors in the file (for a stream known after the first pass)
+            long long seen = 0;
+            int passes = 0, steps = 0;
+            double ewa_inertia = -1.0, best_inertia = std::numeric_limits<double>::max();
+            int no_improvement = 0;
+            const int patience = 10;
+
+            while (passes < max_passes && no_improvement < patience)
+            {
+                // gather the next batch
+                int b = 0;
+                if (stream)
+                {
+                    while (b < batch_size)
+                    {
+                        if (!stream->next(batch_buffer[b])) // end of the file, one more pass
+                        {
+                            if (n == 0)
+                                n = seen;
+                            passes++;
+                            stream->rewind();
+                            if (passes >= max_passes || n == 0)
+                                break;
+                            continue;
+                        }
+                        batch[b] = &batch_buffer[b];
+                        b++;
+                        seen++;
+                    }
+                }
+                else
+                {
+                    for (; b < batch_size; b++)
+                        batch[b] = &(*dataset)[this->uid(eng)];
+                    seen += b;
+                    passes = seen / n;
+                }
+                if (b == 0)
+                    break;
+
+                this->nearest_centers(batch, b, nearest, nearest_dist);
+
+                // move the centers, each one by its own vectors in the order of the batch (centers are independent, so in parallel)
+                double inertia = 0.0;
+                for (int c = 0; c < K; ++c)
+                    members[c].clear();
+                for (int j = 0; j < b; ++j)
+                {
+                    members[nearest[j]].push_back(j);
+                    inertia += nearest_dist[j] * nearest_dist[j];
+                }
+                parallel::for_each_task(K, [&](int c, int)
+                {
+                    vector<double> &center = centers[c].xij;
+                    for (int j : members[c])
+                    {
+                        double eta = 1.0 / (double)(++center_counts[c]);
+                        const vector<double> &x = batch[j]->xij;
+                        for (int d = 0; d < dimensions; ++d)
+                            center[d] += eta * (x[d] - center[d]);
+                    }
+                });
+                steps++;
+
+                // exponentially weighted average of the inertia of the batches (about one pass long), to tell when to stop
+                inertia /= b;
+                double alpha = std::min(1.0, 2.0 * b / (double)((n > 0 ? n : seen) + 1));
+                ewa_inertia = (ewa_inertia < 0) ? inertia : ewa_inertia + alpha * (inertia - ewa_inertia);
+                if (ewa_inertia < best_inertia)
+                {
+                    best_inertia = ewa_inertia;
+                    no_improvement = 0;
+                }
+                else if (passes > 0) // every vector is seen (about) once before stopping early
+                    no_improvement++;
+            }
+
+            // final assignment of every vector to its nearest center
+            if (stream)
+            {
+                stream->rewind();
+                this->streamed_sizes.assign(K, 0);
+                this->streamed_ids.assign(this->params.complete ? K : 0, vector<string>());
+                int b;
+                long long total = 0;
+                do
+                {
+                    for (b = 0; b < batch_size && stream->next(batch_buffer[b]); b++)
+                        batch[b] = &batch_buffer[b];
+                    this->nearest_centers(batch, b, nearest, nearest_dist);
+                    for (int j = 0; j < b; ++j)
+                    {
+                        this->streamed_sizes[nearest[j]]++;
+                        if (this->params.complete)
+                            this->streamed_ids[nearest[j]].push_back(batch[j]->id);
+                    }
+                    total += b;
+                } while (b == batch_size);
+                n = total;
+            }
+            else
+                this->Lloyds_assignment();
+
+            cout << "............................................" << endl;
+            cout << "Mini-batch k-means ended after " << steps << " steps of " << batch_size << " vectors (" << (double)seen / std::max(1LL, n)
+                 << " passes over the dataset)" << endl;
+        }
+
+        // number of items in cluster i and id of its j-th item (whether the dataset was streamed or not)
+        int cluster_size(int i) { return this->streamed_sizes.empty() ? this->clusters.size(i) : this->streamed_sizes[i]; }
+
+        const string &member_id(int i, int j) { return this->streamed_sizes.empty() ? (*dataset)[this->clusters(i, j)].id : this->streamed_ids[i][j]; }
+
         void Reverse_Assignment_LSH_Clustering(int max_iterations)
         {
             // we must construct a discrete Frechet LSH object to pass as parameter in the assignment algorithm
@@ -388,7 +688,7 @@ namespace vector_cluster
 
             int iter = 1; // iterations
 
-            this->initialize_pp();
+            this->initialize_centers();
             Range_LSH_assignment(*lsh_object);
             update_centers();
             vector<Item> old_centers = this->centers;
@@ -408,8 +708,6 @@ namespace vector_cluster
             do
             {
                 last_assignments = this->assignments_vec;
-                for (int i = 0; i < this->clusters.size(); ++i)
-                    this->clusters[i].clear(); // clear clusters so we can reassign the items
                 for (int i = 0; i < dataset->size(); i++)
                     (*dataset)[i].marked = false;
                 Range_LSH_assignment(*lsh_object);
@@ -447,7 +745,7 @@ namespace vector_cluster
 
             int iter = 1; // iterations
 
-            this->initialize_pp();
+            this->initialize_centers();
             Range_HC_assignment(*cube);
             update_centers();
             vector<Item> old_centers = this->centers;
@@ -467,8 +765,6 @@ namespace vector_cluster
             do
             {
                 last_assignments = this->assignments_vec;
-                for (int i = 0; i < this->clusters.size(); ++i)
-                    this->clusters[i].clear(); // clear clusters so we can reassign the items
                 for (int i = 0; i < dataset->size(); i++)
                     (*dataset)[i].marked = false;
                 Range_HC_assignment(*cube);
@@ -493,95 +789,46 @@ namespace vector_cluster
             delete cube;
         }
 
-        // Silhouette of object at index i
-        double silhouette(Item &item)
+        /* Computes the silhouette of every item (or, with sample > 0, of about that many items spread over the clusters) once and in
+        parallel, and keeps the averages in silhouettes for eval_specific_cluster() and eval_clustering(). The neighbour of an item
+        is the cluster of its closest center among the other non empty clusters. */
+        void evaluate_silhouette(int sample = 0)
         {
-            vector<Item> *cluster = &clusters[item.cluster]; // find out at which cluster this item is assigned to
-
-            //  calculate a(i) = average distance of i to objects in same cluster
-            vector<double> distances;
-
-            for (int j = 0; j < (*cluster).size(); ++j)
-            {
-                double dist = EuclideanDistance(&item, &(*cluster)[j], dimensions);
-                distances.push_back(dist);
-            }
-
-            double a = 0.0;
-            for (int j = 0; j < distances.size(); ++j)
-            {
-                a += distances[j] / (double)(distances.size());
-            }
-
-            // calculate b(i) = average distance of i to objects in next best (neighbor) cluster, i.e. cluster of 2nd closest centroid
-            // first find the index of the next best cluster
-            int best;
-            double best_dist = std::numeric_limits<double>::max();
-            for (int j = 0; j < this->centers.size(); ++j)
+            this->silhouettes = silhouette::evaluate(this->clusters, sample, [&](int i, int own)
             {
-                if (j != item.cluster)
+                double best_dist = std::numeric_limits<double>::max();
+                int best = own;
+                for (int c = 0; c < this->centers.size(); ++c)
                 {
-                    double dist = EuclideanDistance(&item, &this->centers[j], dimensions);
-                    if (dist < best_dist)
+                    if (c != own && !this->clusters.empty(c)) // an empty cluster has no items to compare with
                     {
-                        best_dist = dist;
-                        best = j;
+                        double dist = EuclideanDistance(&(*dataset)[i], &this->centers[c], dimensions);
+                        if (dist < best_dist)
+                        {
+                            best_dist = dist;
+                            best = c;
+                        }
                     }
                 }
-            }
-
-            // now perform the calculations
-            distances.clear();
-            cluster = &(this->clusters[best]);
-            for (int j = 0; j < (*cluster).size(); ++j)
-            {
-                double dist = EuclideanDistance(&item, &((*cluster)[j]), dimensions);
-                distances.push_back(dist);
-            }
-            double b = 0.0;
-            for (int j = 0; j < distances.size(); ++j)
-            {
-                b += distances[j] / (double)(distances.size());
-            }
-
-            // find max between a(i) and b(i)
-            double max = a;
-            if (b > a)
-            {
-                max = b;
-            }
-
-            // finally calculate and return silhouette
-            return (b - a) / max;
+                return best; },
+                [&](int i, int j)
+                { return EuclideanDistance(&(*dataset)[i], &(*dataset)[j], dimensions); }, eng);
         }
 
         // metric to evaluate specific cluster (c_index = the index of said cluster)
         double eval_specific_cluster(int c_index)
         {
-            // cout << "Evaluating cluster: " << c_index << endl;
-            double average = 0.0;
-            double s = 0.0;
-            int n = this->clusters[c_index].size();
-            for (int i = 0; i < n; i++)
-            {
-                s = silhouette(clusters[c_index][i]);
-                average += s / (double)n;
-            }
-            return average;
+            if (this->silhouettes.evaluated == 0)
+                evaluate_silhouette();
+            return this->silhouettes.cluster_average[c_index];
         }
 
         // metric to evaluate overall clustering
         double eval_clustering()
         {
-            double average = 0.0;
-            double s = 0.0;
-            int n = this->dataset->size();
-            for (int i = 0; i < n; ++i)
-            {
-                s = silhouette((*dataset)[i]);
-                average += s / (double)n;
-            }
-            return s;
+            if (this->silhouettes.evaluated == 0)
+                evaluate_silhouette();
+            return this->silhouettes.average;
         }
 
     };
@@ -6,6 +6,9 @@
 #include <cmath>
 #include <random>
 #include <time.h>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
 #include "./utils.hpp"
 
 namespace curves
@@ -19,44 +22,230 @@ namespace curves
         Point2d(double x, double y) : x(x), y(y){};
     };
 
+    // allocator that places the buffers of a CurveDataset on a SIMD friendly boundary
+    template <typename T, std::size_t Alignment>
+    class aligned_allocator
+    {
+    public:
+        typedef T value_type;
+
+        template <typename U>
+        struct rebind
+        {
+            typedef aligned_allocator<U, Alignment> other;
+        };
+
+        aligned_allocator() {}
+
+        template <typename U>
+        aligned_allocator(const aligned_allocator<U, Alignment> &) {}
+
+        T *allocate(std::size_t n)
+        {
+            void *ptr = nullptr;
+            if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0)
+                throw std::bad_alloc();
+            return static_cast<T *>(ptr);
+        }
+
+        void deallocate(T *ptr, std::size_t) { free(ptr); }
+    };
+
+    template <typename T, typename U, std::size_t Alignment>
+    bool operator==(const aligned_allocator<T, Alignment> &, const aligned_allocator<U, Alignment> &) { return true; }
+
+    template <typename T, typename U, std::size_t Alignment>
+    bool operator!=(const aligned_allocator<T, Alignment> &, const aligned_allocator<U, Alignment> &) { return false; }
+
+    typedef std::vector<double, aligned_allocator<double, 32>> aligned_buffer;
+
+    /* Read-only span over the vertices of a curve. It does not own its points: it either looks into the packed buffers
+        of a CurveDataset (stride 1) or into a std::vector<Point2d> (stride 2, since x and y are interleaved there).
+        All Frechet kernels and grid snapping functions read curves through this class. */
+    class CurveView
+    {
+    public:
+        const double *xs = nullptr; // first x coordinate
+        const double *ys = nullptr; // first y coordinate
+        int n = 0;                  // number of vertices
+        int stride = 1;             // distance (in doubles) between two consecutive coordinates
+
+        CurveView() {}
+
+        CurveView(const double *xs, const double *ys, int n, int stride = 1) : xs(xs), ys(ys), n(n), stride(stride) {}
+
+        CurveView(const std::vector<Point2d> &points) : n(points.size()), stride(2)
+        {
+            static_assert(sizeof(Point2d) == 2 * sizeof(double), "Point2d must be two packed doubles");
+            if (n > 0)
+            {
+                xs = &points[0].x;
+                ys = &points[0].y;
+            }
+        }
+
+        inline double x(int i) const { return xs[i * stride]; }
+
+        inline double y(int i) const { return ys[i * stride]; }
+
+        inline Point2d operator[](int i) const { return Point2d(x(i), y(i)); }
+
+        inline int size() const { return n; }
+
+        // copies the vertices out of the span (e.g. to use a dataset curve as a cluster center)
+        std::vector<Point2d> points() const
+        {
+            std::vector<Point2d> result;
+            result.reserve(n);
+            for (int i = 0; i < n; i++)
+                result.push_back(Point2d(x(i), y(i)));
+            return result;
+        }
+    };
+
     class Curve2d // curve of 2-dimensional points
     {
     public:
         std::string id;
-        std::vector<Point2d> data;
-        bool success = true; // checks that object was constructed succesfully using 2 vectors of same length
+        CurveView data; // vertices of the curve (stored in a CurveDataset or a Point2d vector that must outlive this object)
 
         int cluster = 0; // index of cluster to which this item is assigned
         // int cluster2 = -1; // second nearest cluster
 
         bool null = false;    // flag if is NULL item created to initialize a pair vector for knn and brute foce algorithms
-        bool claimed = false; // will be used in reverse assignment to indicate if item has been claimed by a ball (in order to resolve conflicts)
         bool marked = false;  // will be used in reverse assignment to indicate item has been assigned to a cluster
 
         Curve2d(std::string id) : id(id) {}
 
-        Curve2d(std::string id, std::vector<Point2d> &p_data) : id(id), data(p_data) {}
+        Curve2d(std::string id, const CurveView &data) : id(id), data(data) {}
+    };
+
+    /* Structure of arrays storage for a whole dataset of curves. All y coordinates live in one contiguous buffer and,
+        for time series, the x coordinates are a single time axis shared by every curve (so they are stored only once).
+        Each curve starts at an offset aligned to 32 bytes, so curves of different lengths can be stored side by side
+        and still be read with aligned SIMD loads. */
+    class CurveDataset
+    {
+        std::vector<double> axis;          // shared x (time) axis, empty if each curve keeps its own x coordinates
+        aligned_buffer xs;                 // x coordinates of all curves (used only when there is no shared axis)
+        aligned_buffer ys;                 // y coordinates of all curves
+        std::vector<std::size_t> offsets;  // index of the first coordinate of each curve inside the buffers
+        std::vector<int> lengths;          // number of vertices of each curve
+        std::vector<std::string> ids;      // id of each curve
+
+        static const std::size_t alignment = 4; // in doubles
+
+        std::size_t next_offset() const
+        {
+            return (ys.size() + alignment - 1) / alignment * alignment;
+        }
+
+    public:
+        CurveDataset() {}
+
+        CurveDataset(const std::vector<double> &axis) : axis(axis) {}
 
-        Curve2d(std::string id, std::vector<double> vector1, std::vector<double> vector2) : id(id)
+        // reserves space for n curves of (at most) m vertices each
+        void reserve(std::size_t n, std::size_t m)
         {
+            std::size_t slot = (m + alignment - 1) / alignment * alignment;
+            ys.reserve(n * slot);
+            if (!this->shared_axis())
+                xs.reserve(n * slot);
+            offsets.reserve(n);
+            lengths.reserve(n);
+            ids.reserve(n);
+        }
 
-            if (vector1.size() != vector2.size())
+        // appends a curve whose x coordinates are the first y.size() values of the shared axis, returns false (and appends
+        // nothing) if it does not fit that axis
+        bool add(const std::string &id, const std::vector<double> &y)
+        {
+            if (!this->shared_axis() || y.size() > axis.size())
             {
-                std::cout << "Please provider data of same dimensions in order to construct curve." << std::endl;
-                this->success = false;
+                std::cout << "Curve " << id << " does not fit the shared time axis of the dataset." << std::endl;
+                return false;
             }
-            else
+            std::size_t offset = this->next_offset();
+            ys.resize(offset, 0.0);
+            ys.insert(ys.end(), y.begin(), y.end());
+            offsets.push_back(offset);
+            lengths.push_back(y.size());
+            ids.push_back(id);
+            return true;
+        }
+
+        // appends a curve with its own x coordinates, returns false (and appends nothing) if they are not as many as the y ones
+        bool add(const std::string &id, const std::vector<double> &x, const std::vector<double> &y)
+        {
+            if (x.size() != y.size())
             {
-                for (int i = 0; i < vector1.size(); i++)
-                {
-                    this->data.push_back(Point2d(vector1[i], vector2[i]));
-                }
+                std::cout << "Please provider data of same dimensions in order to construct curve." << std::endl;
+                return false;
             }
+            if (this->shared_axis())
+                this->detach_axis();
+            std::size_t offset = this->next_offset();
+            ys.resize(offset, 0.0);
+            xs.resize(offset, 0.0);
+            ys.insert(ys.end(), y.begin(), y.end());
+            xs.insert(xs.end(), x.begin(), x.end());
+            offsets.push_back(offset);
+            lengths.push_back(y.size());
+            ids.push_back(id);
+            return true;
+        }
+
+        // copies the shared axis into per-curve x coordinates, so that curves can be edited independently (e.g. filtered)
+        void detach_axis()
+        {
+            if (!this->shared_axis())
+                return;
+            xs.assign(ys.size(), 0.0);
+            for (std::size_t i = 0; i < offsets.size(); i++)
+                std::copy(axis.begin(), axis.begin() + lengths[i], xs.begin() + offsets[i]);
+            axis.clear();
+        }
+
+        inline bool shared_axis() const { return !axis.empty(); }
+
+        inline std::size_t size() const { return ids.size(); }
+
+        inline const std::string &id(std::size_t i) const { return ids[i]; }
+
+        inline int length(std::size_t i) const { return lengths[i]; }
+
+        inline CurveView view(std::size_t i) const
+        {
+            const double *x = this->shared_axis() ? axis.data() : xs.data() + offsets[i];
+            return CurveView(x, ys.data() + offsets[i], lengths[i]);
+        }
+
+        // writable coordinates of curve i (only valid after detach_axis())
+        inline double *x_data(std::size_t i) { return xs.data() + offsets[i]; }
+
+        inline double *y_data(std::size_t i) { return ys.data() + offsets[i]; }
+
+        // drops the trailing vertices of curve i so that it keeps only its first n ones
+        inline void shrink(std::size_t i, int n)
+        {
+            if (n < lengths[i])
+                lengths[i] = n;
+        }
+
+        // lightweight Curve2d handles over all curves of the dataset (they stay valid as long as the dataset is not modified)
+        std::vector<Curve2d> curves() const
+        {
+            std::vector<Curve2d> result;
+            result.reserve(this->size());
+            for (std::size_t i = 0; i < this->size(); i++)
+                result.push_back(Curve2d(ids[i], this->view(i)));
+            return result;
         }
     };
 }
 
-double point2d_L2(curves::Point2d &point1, curves::Point2d &point2) // measures L2 distance of 2 Point2d points
+double point2d_L2(const curves::Point2d &point1, const curves::Point2d &point2) // measures L2 distance of 2 Point2d points
 {
     double dist = pow((point1.x - point2.x), 2) + pow((point1.y - point2.y), 2);
     return sqrt(dist);
@@ -100,34 +289,4 @@ double delta_tuning(std::vector<curves::Curve2d> &curves) // calculates the aver
     return avg;
 }
 
-bool identical_curves(vector<curves::Point2d> &curve1, vector<curves::Point2d> &curve2) // returns true, if 2 curves are identical (used to check grid curves as a querying trick)
-{
-    // int curve_size = curve1.data.size();
-
-    if (curve1.size() != curve2.size())
-        return false;
-
-    for (int i = 0; i < curve1.size(); i++)
-    {
-        if ((curve1[i].x != curve2[i].x) || (curve1[i].y != curve2[i].y))
-            return false;
-    }
-    return true;
-}
-
-bool identical_curves(vector<double> &curve1, vector<double> &curve2) // returns true, if 2 double vectors are identical (used to check grid curves as a querying trick)
-{
-    // int curve_size = curve1.size();
-
-    if (curve1.size() != curve2.size())
-        return false;
-
-    for (int i = 0; i < curve1.size(); i++)
-    {
-        if ((curve1[i] != curve2[i]))
-            return false;
-    }
-    return true;
-}
-
 #endif
\ No newline at end of file
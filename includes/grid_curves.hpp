@@ -0,0 +1,102 @@
+#ifndef GRID_CURVES_HPP
+#define GRID_CURVES_HPP
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include "./curves.hpp"
+
+namespace curves
+{
+    /* Arena that holds the grid-curves produced by the Frechet LSH variants. All grid-curves live back to back in one
+    coordinate buffer (x1,y1,x2,y2,... for 2d grid-curves, plain values for 1d ones) and are referred to by a 32-bit index,
+    so references stay valid no matter how much the arena grows. */
+    class GridCurveStore
+    {
+    private:
+        std::vector<double> coords;        // packed coordinates of all grid-curves
+        std::vector<std::size_t> offsets;  // where each grid-curve starts in coords
+        std::vector<std::uint32_t> counts; // number of coordinates (not points) of each grid-curve
+
+    public:
+        GridCurveStore() {}
+
+        // reserve space for n_curves grid-curves holding (at most) n_coords coordinates in total
+        void reserve(std::size_t n_curves, std::size_t n_coords)
+        {
+            this->coords.reserve(n_coords);
+            this->offsets.reserve(n_curves);
+            this->counts.reserve(n_curves);
+        }
+
+        // give back the space that was reserved but not used (snapping usually shrinks curves)
+        void shrink_to_fit() { this->coords.shrink_to_fit(); }
+
+        // copies n coordinates into the arena and returns the index of the new grid-curve
+        std::uint32_t add(const double *values, std::uint32_t n)
+        {
+            this->offsets.push_back(this->coords.size());
+            this->counts.push_back(n);
+            this->coords.insert(this->coords.end(), values, values + n);
+            return (std::uint32_t)(this->offsets.size() - 1);
+        }
+
+        std::uint32_t add(const std::vector<double> &values) { return this->add(values.data(), (std::uint32_t)values.size()); }
+
+        // copies all grid-curves of another store at the end of this one and returns the index of the first of them
+        std::uint32_t append(const GridCurveStore &other)
+        {
+            std::uint32_t first = (std::uint32_t)this->offsets.size();
+            std::size_t base = this->coords.size();
+            for (std::size_t i = 0; i < other.offsets.size(); i++)
+                this->offsets.push_back(base + other.offsets[i]);
+            this->counts.insert(this->counts.end(), other.counts.begin(), other.counts.end());
+            this->coords.insert(this->coords.end(), other.coords.begin(), other.coords.end());
+            return first;
+        }
+
+        std::size_t size() const { return this->offsets.size(); }
+
+        std::size_t coordinates() const { return this->coords.size(); }
+
+        const double *data(std::uint32_t i) const { return this->coords.data() + this->offsets[i]; }
+
+        std::uint32_t count(std::uint32_t i) const { return this->counts[i]; }
+
+        /* 64-bit FNV-1a fingerprint of n coordinates, so that identical grid-curves can be found with a hash map probe. The
+        bytes of -0.0 are hashed as the ones of 0.0, since the two compare equal (see identical()). This is done on the bits,
+        because -ffast-math lets the compiler ignore the sign of zero in floating point code. */
+        static std::uint64_t fingerprint(const double *values, std::uint32_t n)
+        {
+            std::uint64_t h = 14695981039346656037ULL;
+            for (std::uint32_t i = 0; i < n; i++)
+            {
+                std::uint64_t bits;
+                std::memcpy(&bits, &values[i], sizeof(double));
+                if ((bits << 1) == 0) // +0.0 or -0.0
+                    bits = 0;
+                for (int b = 0; b < 64; b += 8)
+                {
+                    h ^= (bits >> b) & 0xff;
+                    h *= 1099511628211ULL;
+                }
+            }
+            return h;
+        }
+
+        std::uint64_t fingerprint(std::uint32_t i) const { return fingerprint(this->data(i), this->counts[i]); }
+
+        // true if grid-curve i holds exactly the n given coordinates (compared as values, like the old identical_curves())
+        bool identical(std::uint32_t i, const double *values, std::uint32_t n) const
+        {
+            if (this->counts[i] != n)
+                return false;
+            const double *stored = this->data(i);
+            for (std::uint32_t j = 0; j < n; j++)
+                if (stored[j] != values[j])
+                    return false;
+            return true;
+        }
+    };
+}
+
+#endif
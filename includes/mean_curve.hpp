@@ -6,33 +6,93 @@
 #include <string>
 #include "../TimeSeries-ANN/DiscreteFrechet/disc_Frechet.hpp"
 #include "../TimeSeries-ANN/ContinuousFrechet/contF_LSH.hpp"
+#include "./parallel.hpp"
 
-// finds an optimal traversal between two curves using discrete Frechet distance
-// optimal traversal will be returned in reverse so as to not waste time reversing it
-vector<std::pair<int, int>> optimal_traversal(curves::Curve2d &p, curves::Curve2d &q)
+/* The rows of the dynamic programming table of discrete Frechet that optimal_traversal() needs, without keeping the whole
+p.size() x q.size() table: a first pass keeps every k-th row (k about sqrt(p.size())) as a checkpoint, and the k - 1 rows
+after the checkpoint the backtracking is currently at are recomputed from it when it gets there. The backtracking only
+moves to lower rows, so every block is recomputed at most once: about 2 * sqrt(p.size()) rows in memory for at most twice
+the work, and the values (so the traversal) are exactly those of the full table. */
+class TraversalRows
 {
-    // get dynamic programming table from discrete Frechet
-    double **c = dF::discrete_frechet_table(p, q);
+private:
+    dF::Table checkpoints; // rows 0, k, 2k, ...
+    dF::Table block;       // rows block_start + 1, ..., block_start + k - 1 (at positions 1, ..., k - 1)
+    int k = 1;
+    int block_start = -1;
+    int pl = 0;
+    const curves::CurveView *p = nullptr;
+    const curves::CurveView *q = nullptr;
 
-    // initialise empty list(aka vector) of pairs
-    std::vector<std::pair<int, int>> traversal;
+    // row i goes to a checkpoint or to its place in the block
+    double *slot(int i) { return (i % this->k == 0) ? this->checkpoints.row(i / this->k) : this->block.row(i % this->k); }
+
+public:
+    // first pass over the table of p and q (both have to outlive the use of row())
+    void build(const curves::CurveView &p, const curves::CurveView &q)
+    {
+        this->p = &p;
+        this->q = &q;
+        this->pl = p.size();
+        this->k = std::max(1, (int)ceil(sqrt((double)this->pl)));
+        this->checkpoints.resize((this->pl + this->k - 1) / this->k, q.size());
+        this->block.resize(this->k, q.size());
+
+        const double *prev = nullptr;
+        for (int i = 0; i < this->pl; i++)
+        {
+            double *curr = this->slot(i);
+            dF::fill_row(prev, curr, i, p, q);
+            prev = curr;
+        }
+        // the block of the last checkpoint is still in place
+        this->block_start = (this->pl - 1) / this->k * this->k;
+    }
+
+    const double *row(int i)
+    {
+        if (i % this->k == 0)
+            return this->checkpoints.row(i / this->k);
+        int start = i / this->k * this->k;
+        if (start != this->block_start)
+        {
+            int last = std::min(start + this->k - 1, this->pl - 1);
+            for (int r = start + 1; r <= last; r++)
+                dF::fill_row(this->slot(r - 1), this->slot(r), r, *this->p, *this->q);
+            this->block_start = start;
+        }
+        return this->block.row(i - start);
+    }
+};
+
+// finds an optimal traversal between two curves using discrete Frechet distance, rows keeps (part of) the dynamic programming table
+// optimal traversal will be written in reverse (into traversal) so as to not waste time reversing it
+void optimal_traversal(const curves::CurveView &p, const curves::CurveView &q, TraversalRows &rows, std::vector<std::pair<int, int>> &traversal)
+{
+    // first pass over the dynamic programming table of discrete Frechet
+    rows.build(p, q);
+
+    // start from an empty list(aka vector) of pairs
+    traversal.clear();
     // pi = m1; qi = m2
-    traversal.push_back(std::make_pair(p.data.size() - 1, q.data.size() - 1));
+    traversal.push_back(std::make_pair(p.size() - 1, q.size() - 1));
     int pi = traversal.back().first;
     int qi = traversal.back().second;
     while ((pi != 0) && (qi != 0))
     {
-        // find next optimal step using the table of discrete Frechet
+        // find next optimal step using the table of discrete Frechet (rows pi and pi - 1 of it)
+        const double *c_pi = rows.row(pi);
+        const double *c_prev = rows.row(pi - 1);
         int minIdx_p = pi - 1;
         int minIdx_q = qi;
-        double mindist = c[pi - 1][qi];
-        if (c[pi][qi - 1] < mindist)
+        double mindist = c_prev[qi];
+        if (c_pi[qi - 1] < mindist)
         {
             minIdx_p = pi;
             minIdx_q = qi - 1;
-            mindist = c[pi][qi - 1];
+            mindist = c_pi[qi - 1];
         }
-        if (c[pi - 1][qi - 1] < mindist)
+        if (c_prev[qi - 1] < mindist)
         {
             minIdx_p = pi - 1;
             minIdx_q = qi - 1;
@@ -43,11 +103,6 @@ vector<std::pair<int, int>> optimal_traversal(curves::Curve2d &p, curves::Curve2
         pi = minIdx_p;
         qi = minIdx_q;
     }
-    for (int i = 0; i < p.data.size(); i++)
-    {
-        delete[] c[i];
-    }
-    delete[] c;
 
     // corner-cases of endgame
     while (pi != 0) // if curve p still has steps to go but q has ended
@@ -60,75 +115,81 @@ vector<std::pair<int, int>> optimal_traversal(curves::Curve2d &p, curves::Curve2
         traversal.push_back(std::make_pair(pi, qi - 1));
         qi--;
     }
+    // Warning: traversal is written in reverse so as to save time
+}
+
+vector<std::pair<int, int>> optimal_traversal(const curves::CurveView &p, const curves::CurveView &q)
+{
+    TraversalRows rows;
+    std::vector<std::pair<int, int>> traversal;
+    optimal_traversal(p, q, rows, traversal);
     return traversal; // Warning: traversal is returned in reverse so as to save time
 }
 
-// calculates mean curve of two given curves using discrete Frechet distance
-std::vector<curves::Point2d> mean_curve(curves::Curve2d &p, curves::Curve2d &q)
+// calculates mean curve of two given curves using discrete Frechet distance and writes it into mean (reusing its space)
+void mean_curve(const curves::CurveView &p, const curves::CurveView &q, std::vector<curves::Point2d> &mean)
 {
-    std::vector<curves::Point2d> mean;
-    std::vector<std::pair<int, int>> opt_traversal = optimal_traversal(p, q);
+    // the table rows and the traversal are kept per thread, so that consecutive means do not allocate them again
+    static thread_local TraversalRows rows;
+    static thread_local std::vector<std::pair<int, int>> opt_traversal;
+    optimal_traversal(p, q, rows, opt_traversal);
+
+    mean.clear();
+    mean.reserve(opt_traversal.size());
 
     // iterate in reverse because optimal traversal will be return in reverse from optimal_traversal(p,q)
     for (int t = opt_traversal.size() - 1; t >= 0; t--)
     {
         std::pair<int, int> traversal_indexes = opt_traversal[t];
-        double pit_x = p.data[traversal_indexes.first].x;
-        double pit_y = p.data[traversal_indexes.first].y;
-        double qit_x = q.data[traversal_indexes.second].x;
-        double qit_y = q.data[traversal_indexes.second].y;
+        double pit_x = p.x(traversal_indexes.first);
+        double pit_y = p.y(traversal_indexes.first);
+        double qit_x = q.x(traversal_indexes.second);
+        double qit_y = q.y(traversal_indexes.second);
         mean.push_back(curves::Point2d((pit_x + qit_x) / 2, (pit_y + qit_y) / 2));
     }
     cF::filter_curve(mean, 1.0);
+}
+
+std::vector<curves::Point2d> mean_curve(const curves::CurveView &p, const curves::CurveView &q)
+{
+    std::vector<curves::Point2d> mean;
+    mean_curve(p, q, mean);
     return mean;
 }
 
-// calculates the mean curve of multiple curves given in a std::vector using discrete Frechet distance
-std::vector<curves::Point2d> mean_of_curves(vector<curves::Curve2d> &curves)
+/* calculates the mean curve of the n curves dataset[members[0]] ... dataset[members[n - 1]] using discrete Frechet distance
+(members is usually a cluster of a Membership, so the curves are never copied). The curves are merged as the leaves of a balanced binary tree: every level averages neighbouring pairs (0 with 1, 2 with 3, ...)
+in parallel, an odd one out moves up a level as it is, and the means of a level are written into the buffers of the level
+before the previous one, so their space is reused. No curves give an empty mean. */
+std::vector<curves::Point2d> mean_of_curves(const vector<curves::Curve2d> &dataset, const int *members, int n)
 {
-    vector<vector<curves::Point2d>> curves_points;
-    int i = 0;
-    int remaining = curves.size();
+    if (n == 0)
+        return std::vector<curves::Point2d>();
 
-    while (remaining > 0)
+    // first level, straight from the curves
+    vector<vector<curves::Point2d>> level((n + 1) / 2), next;
+    parallel::for_each_task(n / 2, [&](int pair, int)
     {
-        if (remaining == 1)
-        {
-            curves_points.push_back(curves[0].data);
-            remaining -= 1;
-        }
-        else
-        {
-            curves_points.push_back(mean_curve(curves[remaining - 2], curves[remaining - 1]));
-            remaining -= 2;
-        }
-    }
-    // remaining=curves_points.size();
+        mean_curve(dataset[members[2 * pair]].data, dataset[members[2 * pair + 1]].data, level[pair]);
+    });
+    if (n % 2 == 1)
+        level.back() = dataset[members[n - 1]].data.points();
 
-    while (curves_points.size() != 1)
+    while (level.size() > 1)
     {
-        // std::cout << curves_points.size() << endl;
-        remaining = curves_points.size();
-        while (remaining > 1)
+        int m = level.size();
+        next.resize((m + 1) / 2);
+        parallel::for_each_task(m / 2, [&](int pair, int)
         {
-            // std::cout << "remaining: " << remaining << endl;
-            curves::Curve2d curve1 = curves::Curve2d("null", curves_points[remaining - 2]);
-            curves::Curve2d curve2 = curves::Curve2d("null", curves_points[remaining - 1]);
-            curves_points.push_back(mean_curve(curve1, curve2));
-            curves_points.erase(curves_points.begin() + remaining - 1);
-            curves_points.erase(curves_points.begin() + remaining - 2);
-            remaining -= 2;
-        }
+            mean_curve(level[2 * pair], level[2 * pair + 1], next[pair]);
+        });
+        if (m % 2 == 1)
+            next.back().swap(level[m - 1]);
+        level.swap(next);
     }
 
-    // std::cout << curves_points.size() << endl;
-    // std::cout << curves_points[0].size() << endl;
-    // for(int i=0; i<curves_points[0].size(); i++)
-    // {
-    //     cout << "[" << curves_points[0][i].x << ", " << curves_points[0][i].y << "] ";
-    // }
-    cF::filter_curve(curves_points[0], 2.0);
-    return curves_points[0];
+    cF::filter_curve(level[0], 2.0);
+    return std::move(level[0]);
 }
 
 #endif
\ No newline at end of file
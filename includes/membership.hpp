@@ -0,0 +1,45 @@
+#ifndef MEMBERSHIP_HPP
+#define MEMBERSHIP_HPP
+#include <vector>
+
+/* The items of each cluster, as indices in the dataset. All clusters share one array (items) in which cluster c is the range
+items[offsets[c]] ... items[offsets[c + 1] - 1] (compressed sparse rows), so rebuilding the clusters after an assignment step is a
+counting sort of the assignments and never copies an item. */
+class Membership
+{
+    std::vector<int> offsets;
+    std::vector<int> items;
+
+public:
+    Membership(int n_clusters = 0) : offsets(n_clusters + 1, 0) {}
+
+    // groups the items by cluster (assignments[i] is the cluster of item i), keeping the order of the dataset in every cluster
+    void build(const std::vector<int> &assignments, int n_clusters)
+    {
+        this->offsets.assign(n_clusters + 1, 0);
+        for (int i = 0; i < (int)assignments.size(); ++i)
+            this->offsets[assignments[i] + 1]++;
+        for (int c = 0; c < n_clusters; ++c)
+            this->offsets[c + 1] += this->offsets[c];
+
+        this->items.resize(assignments.size());
+        std::vector<int> next(this->offsets.begin(), this->offsets.end() - 1);
+        for (int i = 0; i < (int)assignments.size(); ++i)
+            this->items[next[assignments[i]]++] = i;
+    }
+
+    int clusters() const { return this->offsets.size() - 1; }
+
+    int size(int c) const { return this->offsets[c + 1] - this->offsets[c]; }
+
+    bool empty(int c) const { return this->size(c) == 0; }
+
+    // index (in the dataset) of the j-th item of cluster c
+    int operator()(int c, int j) const { return this->items[this->offsets[c] + j]; }
+
+    const int *begin(int c) const { return this->items.data() + this->offsets[c]; }
+
+    const int *end(int c) const { return this->items.data() + this->offsets[c + 1]; }
+};
+
+#endif
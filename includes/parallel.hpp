@@ -0,0 +1,157 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+namespace parallel
+{
+    // number of threads the loops below are allowed to use (can be set from the command line with -threads)
+    inline int &threads()
+    {
+        static int n = std::max(1u, std::thread::hardware_concurrency());
+        return n;
+    }
+
+    // a non positive value means "use every core"
+    inline void set_threads(int n)
+    {
+        threads() = (n > 0) ? n : (int)std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // true while the calling thread runs tasks of for_each_task(), so that nested calls do not start more threads
+    inline bool &nested()
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    // number of workers that for_each_task() will use for n_tasks tasks
+    inline int workers(int n_tasks)
+    {
+        if (nested())
+            return 1;
+        return std::max(1, std::min(threads(), n_tasks));
+    }
+
+    /* Threads that stay alive for the whole program and run the share of every for_each_task() that is not run by the calling
+    thread, so that short loops do not pay for starting threads and what the workers keep in thread_local storage (e.g. the
+    buffers of mean_curve()) is reused from one loop to the next. Worker w (1, 2, ...) is always the same thread. */
+    class Pool
+    {
+        std::vector<std::thread> pool;
+        std::mutex m;
+        std::condition_variable wake; // a new job (or stop) for the workers
+        std::condition_variable done; // the last worker of the job finished
+        const std::function<void(int)> *job = nullptr;
+        int job_workers = 0;   // workers 0 ... job_workers - 1 take part in the current job
+        long generation = 0;   // number of jobs started so far
+        int running = 0;       // pool workers still running the current job
+        bool stop = false;
+        std::mutex busy;       // held by the thread whose job the pool runs
+
+        void loop(int worker)
+        {
+            long seen = 0;
+            std::unique_lock<std::mutex> lock(this->m);
+            while (true)
+            {
+                this->wake.wait(lock, [&]
+                                { return this->stop || this->generation != seen; });
+                if (this->stop)
+                    return;
+                seen = this->generation;
+                if (worker >= this->job_workers)
+                    continue;
+                const std::function<void(int)> *work = this->job;
+                lock.unlock();
+                (*work)(worker);
+                lock.lock();
+                if (--this->running == 0)
+                    this->done.notify_one();
+            }
+        }
+
+    public:
+        ~Pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->m);
+                this->stop = true;
+            }
+            this->wake.notify_all();
+            for (int w = 0; w < (int)this->pool.size(); w++)
+                this->pool[w].join();
+        }
+
+        /* Runs work(0) on the calling thread and work(1) ... work(n_workers - 1) on the pool, starting the workers that are still
+        missing, and returns when all of them are done. Returns false without running anything if the pool is running the job
+        of another thread. */
+        bool run(int n_workers, const std::function<void(int)> &work)
+        {
+            std::unique_lock<std::mutex> owner(this->busy, std::try_to_lock);
+            if (!owner.owns_lock())
+                return false;
+            {
+                std::lock_guard<std::mutex> lock(this->m);
+                while ((int)this->pool.size() < n_workers - 1)
+                    this->pool.emplace_back(&Pool::loop, this, (int)this->pool.size() + 1);
+                this->job = &work;
+                this->job_workers = n_workers;
+                this->running = n_workers - 1;
+                this->generation++;
+            }
+            this->wake.notify_all();
+            work(0);
+            std::unique_lock<std::mutex> lock(this->m);
+            this->done.wait(lock, [&]
+                            { return this->running == 0; });
+            this->job = nullptr;
+            return true;
+        }
+    };
+
+    inline Pool &pool()
+    {
+        static Pool workers;
+        return workers;
+    }
+
+    /* Calls body(task, worker) for every task in [0, n_tasks). Tasks are handed out one by one to the workers, and worker is the
+    index (0 ... workers(n_tasks)-1) of the one running the task, so that callers can keep per-worker scratch space.
+    With a single worker (or when called from inside another for_each_task) everything runs on the calling thread, in order. */
+    template <typename Body>
+    void for_each_task(int n_tasks, Body body)
+    {
+        int n_workers = workers(n_tasks);
+        if (n_workers > 1)
+        {
+            std::atomic<int> next(0);
+            std::function<void(int)> work = [&](int worker)
+            {
+                nested() = true;
+                for (int task = next++; task < n_tasks; task = next++)
+                    body(task, worker);
+                nested() = false;
+            };
+            if (pool().run(n_workers, work))
+                return;
+            // else another thread is using the pool
+        }
+        for (int task = 0; task < n_tasks; task++)
+            body(task, 0);
+    }
+
+    // in how many chunks to split n items, so that every worker gets a few chunks of at least min_chunk items
+    inline int chunks(int n, int min_chunk)
+    {
+        int by_size = std::max(1, n / std::max(1, min_chunk));
+        return std::min(by_size, 4 * threads());
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef RANGE_CLAIMS_HPP
+#define RANGE_CLAIMS_HPP
+#include <vector>
+
+/* Claims of the balls of one round of reverse assignment by range search. Every item keeps the closest center whose ball found it
+(and its distance from it, as computed by the range search) in dense arrays indexed by its position in the dataset. Entries are
+stamped with the round that wrote them, so a new round starts by increasing the stamp instead of clearing anything, and a
+conflict between two balls is resolved by comparing the stored distance with the new one. */
+class RangeClaims
+{
+    std::vector<int> stamp;     // round in which each item was last claimed
+    std::vector<int> center;    // closest center that claimed it in that round
+    std::vector<double> dist;   // and its distance from that center
+    std::vector<int> claimed;   // items claimed in the current round, in the order they were first claimed
+    int round = 0;
+
+public:
+    RangeClaims(int n_items = 0) : stamp(n_items, -1), center(n_items), dist(n_items) { claimed.reserve(n_items); }
+
+    void next_round()
+    {
+        this->round++;
+        this->claimed.clear();
+    }
+
+    // the ball of center c found item i at distance d (the closest center keeps it, the first one on ties)
+    void claim(int i, int c, double d)
+    {
+        if (this->stamp[i] != this->round)
+        {
+            this->stamp[i] = this->round;
+            this->center[i] = c;
+            this->dist[i] = d;
+            this->claimed.push_back(i);
+        }
+        else if (d < this->dist[i])
+        {
+            this->center[i] = c;
+            this->dist[i] = d;
+        }
+    }
+
+    const std::vector<int> &items() const { return this->claimed; }
+
+    // closest center that claimed item i in the current round
+    int center_of(int i) const { return this->center[i]; }
+};
+
+#endif
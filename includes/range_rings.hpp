@@ -0,0 +1,101 @@
+#ifndef RANGE_RINGS_HPP
+#define RANGE_RINGS_HPP
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "./parallel.hpp"
+
+/* Incremental range search around one query, for searches whose radius only grows (like the rounds of reverse assignment).
+The backend (LSH, Hypercube or discrete Frechet LSH) walks its buckets once and hands over the unmarked items it found, in the
+order it found them, together with the distance from the query. Every call of grow(radius) returns the unmarked candidates
+closer than radius that earlier calls did not return, and no distance is ever computed twice.
+Without a limit every candidate is examined, so all distances are computed up front (split among the threads) and the candidates
+are sorted by distance: each call only walks the ring [previous radius, radius). With a limit, each call examines (as a plain
+range search would) at most limit unmarked candidates, in the order they were found: the ones examined by earlier calls first,
+with their cached distances, and then as many new ones as the limit allows. */
+template <typename T>
+class RangeRings
+{
+    std::function<double(const T *)> dist; // distance of a candidate from the query
+    int limit = 0;                          // max unmarked candidates examined by each grow() (0 for no limit)
+    std::vector<T *> found;                 // the candidates, in the order the backend found them
+    std::vector<std::pair<double, T *>> examined; // (distance, candidate): all of them sorted by distance without a limit,
+                                                  // else the ones examined so far (and still unmarked) in the order they were found
+    std::size_t next = 0;                   // without a limit the first candidate not reached by the radius, else the first
+                                            // candidate of found not examined yet
+
+public:
+    RangeRings() {}
+
+    // duplicates in found (the same item in the buckets of many hash tables) are dropped, keeping the first one; min_chunk is the
+    // number of distances each thread computes at least, when they are computed up front
+    RangeRings(std::vector<T *> found, std::function<double(const T *)> dist, int limit = 0, int min_chunk = 256) : dist(dist), limit(limit)
+    {
+        std::vector<std::pair<T *, int>> order; // (candidate, position in found)
+        for (int j = 0; j < (int)found.size(); ++j)
+            order.push_back(std::make_pair(found[j], j));
+        std::sort(order.begin(), order.end());
+        order.erase(std::unique(order.begin(), order.end(), [](const std::pair<T *, int> &a, const std::pair<T *, int> &b)
+                                { return a.first == b.first; }),
+                    order.end());
+        std::sort(order.begin(), order.end(), [](const std::pair<T *, int> &a, const std::pair<T *, int> &b)
+                  { return a.second < b.second; });
+        for (int j = 0; j < (int)order.size(); ++j)
+            this->found.push_back(order[j].first);
+
+        if (this->limit > 0)
+            return;
+
+        int n = this->found.size();
+        this->examined.resize(n);
+        int n_parts = parallel::chunks(n, min_chunk);
+        parallel::for_each_task(n_parts, [&](int part, int)
+        {
+            int first = (int)((long long)n * part / n_parts), last = (int)((long long)n * (part + 1) / n_parts);
+            for (int j = first; j < last; ++j)
+                this->examined[j] = std::make_pair(this->dist(this->found[j]), this->found[j]);
+        });
+        std::sort(this->examined.begin(), this->examined.end(), [](const std::pair<double, T *> &a, const std::pair<double, T *> &b)
+                  { return a.first < b.first; });
+    }
+
+    // (distance, item) pairs of the unmarked candidates at distance less than radius that previous calls did not return
+    std::vector<std::pair<double, T *>> grow(double radius)
+    {
+        std::vector<std::pair<double, T *>> ring;
+        if (this->limit == 0)
+        {
+            for (; this->next < this->examined.size() && this->examined[this->next].first < radius; ++this->next)
+                if (!this->examined[this->next].second->marked)
+                    ring.push_back(this->examined[this->next]);
+            return ring;
+        }
+
+        // candidates examined before, unless they have been marked since (this includes every one returned by earlier calls)
+        std::size_t kept = 0;
+        for (std::size_t j = 0; j < this->examined.size(); ++j)
+            if (!this->examined[j].second->marked)
+                this->examined[kept++] = this->examined[j];
+        this->examined.resize(kept);
+        int count = 0;
+        for (; count < (int)this->examined.size() && count < this->limit; ++count)
+            if (this->examined[count].first < radius)
+                ring.push_back(this->examined[count]);
+
+        // and new ones, up to the limit
+        for (; count < this->limit && this->next < this->found.size(); ++this->next)
+        {
+            T *candidate = this->found[this->next];
+            if (candidate->marked)
+                continue;
+            this->examined.push_back(std::make_pair(this->dist(candidate), candidate));
+            if (this->examined.back().first < radius)
+                ring.push_back(this->examined.back());
+            count++;
+        }
+        return ring;
+    }
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef SEEDING_HPP
+#define SEEDING_HPP
+#include <vector>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include "./parallel.hpp"
+
+namespace seeding
+{
+    /* Keeps for every one of n points its distance from the closest center (min_d) and which center that is (nearest), comparing
+    each point only with the centers added since the last call (incremental, instead of comparing with all centers every time).
+    dist(i, c) is the distance of point i from center c. The points are split among the threads and the sum of the squared
+    distances is returned, added up part by part in order so that it does not depend on the scheduling of the threads. */
+    template <typename Dist>
+    double add_centers(int n, const std::vector<int> &centers, int first_new, std::vector<double> &min_d, std::vector<int> &nearest, Dist dist)
+    {
+        int n_parts = parallel::chunks(n, 16);
+        std::vector<double> part_sums(n_parts, 0.0);
+        parallel::for_each_task(n_parts, [&](int part, int)
+        {
+            int first = (int)((long long)n * part / n_parts), last = (int)((long long)n * (part + 1) / n_parts);
+            for (int i = first; i < last; ++i)
+            {
+                for (int c = first_new; c < (int)centers.size(); ++c)
+                {
+                    double d = dist(i, centers[c]);
+                    if (d < min_d[i])
+                    {
+                        min_d[i] = d;
+                        nearest[i] = c;
+                    }
+                }
+                part_sums[part] += min_d[i] * min_d[i];
+            }
+        });
+        double sum = 0.0;
+        for (int part = 0; part < n_parts; ++part)
+            sum += part_sums[part];
+        return sum;
+    }
+
+    /* k-means++ over n weighted points: the first center is picked with probability proportional to its weight and each next one
+    with probability proportional to weight * D^2, D being its distance from the closest center picked so far. Returns the indices
+    of the (at most K) picked points. */
+    template <typename Dist>
+    std::vector<int> weighted_kmeans_pp(int n, int K, const std::vector<double> &weights, Dist dist, std::default_random_engine &eng)
+    {
+        std::vector<int> centers;
+        std::vector<double> min_d(n, std::numeric_limits<double>::max());
+        std::vector<int> nearest(n, -1);
+        std::vector<double> p(weights);
+
+        while ((int)centers.size() < K && (int)centers.size() < n)
+        {
+            std::discrete_distribution<int> distribution(p.begin(), p.end());
+            centers.push_back(distribution(eng));
+            add_centers(n, centers, centers.size() - 1, min_d, nearest, dist);
+
+            double total = 0.0;
+            for (int i = 0; i < n; ++i)
+            {
+                p[i] = weights[i] * min_d[i] * min_d[i];
+                total += p[i];
+            }
+            if (total == 0.0) // every point coincides with a center
+                break;
+        }
+        return centers;
+    }
+
+    /* k-means|| initialization (Bahmani et al., "Scalable k-means++") of K centers among n points, where dist(i, j) is the
+    distance between points i and j. Starting from a random point, each of the rounds samples every point independently with
+    probability oversampling * K * D^2 / (sum of all D^2), so a few passes over the points give about rounds * oversampling * K
+    candidates instead of the K sequential passes (each against all centers) of k-means++. Every candidate is then weighted by
+    the number of points closest to it and K centers are picked among the candidates by weighted k-means++.
+    Returns the indices of the K points picked as centers. */
+    template <typename Dist>
+    std::vector<int> kmeans_parallel(int n, int K, Dist dist, std::default_random_engine &eng, int rounds = 5, double oversampling = 0.5)
+    {
+        std::vector<int> candidates;
+        std::vector<double> min_d(n, std::numeric_limits<double>::max()); // distance of each point from its closest candidate
+        std::vector<int> nearest(n, -1);                                   // and which candidate that is
+        std::vector<char> is_candidate(n, 0);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+        // pick first candidate at random
+        candidates.push_back(std::uniform_int_distribution<int>(0, n - 1)(eng));
+        is_candidate[candidates[0]] = 1;
+        double cost = add_centers(n, candidates, 0, min_d, nearest, dist);
+
+        // oversampling rounds (more of them if there are still less than K candidates)
+        double l = std::max(1.0, oversampling * K);
+        for (int round = 0; (round < rounds || (int)candidates.size() < K) && cost > 0.0; ++round)
+        {
+            int first_new = candidates.size();
+            for (int i = 0; i < n; ++i)
+            {
+                double u = uniform(eng);
+                if (!is_candidate[i] && u < l * min_d[i] * min_d[i] / cost)
+                {
+                    candidates.push_back(i);
+                    is_candidate[i] = 1;
+                }
+            }
+            cost = add_centers(n, candidates, first_new, min_d, nearest, dist);
+        }
+
+        // weight of each candidate = number of points closest to it
+        std::vector<double> weights(candidates.size(), 0.0);
+        for (int i = 0; i < n; ++i)
+            weights[nearest[i]] += 1.0;
+
+        // recluster the weighted candidates into K centers
+        std::vector<int> picked = weighted_kmeans_pp(candidates.size(), K, weights, [&](int a, int b)
+                                                     { return dist(candidates[a], candidates[b]); }, eng);
+        std::vector<int> centers;
+        for (int c = 0; c < (int)picked.size(); ++c)
+            centers.push_back(candidates[picked[c]]);
+        // a dataset with less than K distinct points: the remaining centers repeat random points (as k-means++ would)
+        while ((int)centers.size() < K)
+            centers.push_back(std::uniform_int_distribution<int>(0, n - 1)(eng));
+        return centers;
+    }
+
+    /* Picks K initial centers among n points, where dist(i, j) is the distance between points i and j: with k-means|| if rounds is
+    positive, else with k-means++ (weighted_kmeans_pp() with unit weights). Both only compare the points with the centers added
+    since their last pass, in parallel, so k-means++ makes K passes of n distances and k-means|| rounds + 1 passes that cost about
+    n * (1 + rounds * oversampling * K) distances in total. Returns the indices of the K points. */
+    template <typename Dist>
+    std::vector<int> initial_centers(int n, int K, Dist dist, std::default_random_engine &eng, int rounds = 0, double oversampling = 0.5)
+    {
+        if (rounds > 0)
+            return kmeans_parallel(n, K, dist, eng, rounds, oversampling);
+
+        std::vector<int> centers = weighted_kmeans_pp(n, K, std::vector<double>(n, 1.0), dist, eng);
+        // a dataset with less than K distinct points: the remaining centers repeat random points (as in kmeans_parallel())
+        while ((int)centers.size() < K)
+            centers.push_back(std::uniform_int_distribution<int>(0, n - 1)(eng));
+        return centers;
+    }
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef SILHOUETTE_HPP
+#define SILHOUETTE_HPP
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "./parallel.hpp"
+#include "./membership.hpp"
+
+namespace silhouette
+{
+    /* Average silhouette of every cluster and of the whole clustering. When only a sample of the items was evaluated the averages
+    are estimates and the margins are the half widths of their 95% confidence intervals (they are 0 when every item was evaluated). */
+    struct Report
+    {
+        std::vector<double> cluster_average;
+        std::vector<double> cluster_margin;
+        double average = 0.0;
+        double margin = 0.0;
+        int evaluated = 0; // number of items whose silhouette was computed (0 until evaluate() runs)
+        int items = 0;     // number of items in the clusters
+    };
+
+    /* Silhouette (b - a) / max(a, b) of item i of cluster own, where a is the average distance of i from the other items of its
+    cluster and b from the items of cluster neighbour (the closest other non empty cluster). dist(i, j) is the distance between
+    items i and j of the dataset. An item that is alone in its cluster or has no neighbour (every other cluster is empty) gets 0. */
+    template <typename Dist>
+    double of_item(int i, int own, int neighbour, const Membership &clusters, Dist dist)
+    {
+        if (neighbour == own || clusters.size(own) == 1)
+            return 0.0;
+        double a = 0.0;
+        for (const int *j = clusters.begin(own); j != clusters.end(own); ++j)
+            if (*j != i)
+                a += dist(i, *j);
+        a /= (double)(clusters.size(own) - 1);
+
+        double b = 0.0;
+        for (const int *j = clusters.begin(neighbour); j != clusters.end(neighbour); ++j)
+            b += dist(i, *j);
+        b /= (double)clusters.size(neighbour);
+
+        double max = std::max(a, b);
+        return (max > 0.0) ? (b - a) / max : 0.0;
+    }
+
+    /* Computes the silhouette of every item of the clusters once, in parallel, and averages it per cluster and overall.
+    neighbour(i, own) is the neighbour cluster of item i (own being its cluster, see of_item()) and dist(i, j) the distance
+    between items i and j. Each silhouette costs a pass over two clusters, so for large datasets sample > 0 evaluates only about
+    that many items: each cluster gets a share of the sample proportional to its size (at least 2 items, so that its variance can
+    be estimated), the overall average is weighted by the cluster sizes and the margins come from the variance of the sampled
+    silhouettes (normal approximation, with finite population correction). */
+    template <typename Neighbour, typename Dist>
+    Report evaluate(const Membership &clusters, int sample, Neighbour neighbour, Dist dist, std::default_random_engine &eng)
+    {
+        int K = clusters.clusters();
+        Report report;
+        report.cluster_average.assign(K, 0.0);
+        report.cluster_margin.assign(K, 0.0);
+        for (int c = 0; c < K; ++c)
+            report.items += clusters.size(c);
+        int n = report.items;
+        if (n == 0)
+            return report;
+
+        // items to evaluate, grouped by cluster (first[c] ... first[c + 1] - 1 are the ones of cluster c)
+        std::vector<int> picked;
+        std::vector<int> first(K + 1, 0);
+        bool sampled = sample > 0 && sample < n;
+        for (int c = 0; c < K; ++c)
+        {
+            first[c] = picked.size();
+            int n_c = clusters.size(c);
+            int m_c = n_c;
+            if (sampled)
+                m_c = std::min(n_c, std::max(2, (int)std::ceil((double)sample * n_c / n)));
+            picked.insert(picked.end(), clusters.begin(c), clusters.end(c));
+            // partial shuffle: the first m_c members become a uniform sample of the cluster
+            for (int j = 0; j < m_c && m_c < n_c; ++j)
+                std::swap(picked[first[c] + j], picked[first[c] + std::uniform_int_distribution<int>(j, n_c - 1)(eng)]);
+            picked.resize(first[c] + m_c);
+        }
+        first[K] = picked.size();
+
+        // the silhouettes themselves, a few items per task since each one is O(n) distances
+        int m = picked.size();
+        std::vector<int> owner(m);
+        for (int c = 0; c < K; ++c)
+            for (int j = first[c]; j < first[c + 1]; ++j)
+                owner[j] = c;
+        std::vector<double> s(m);
+        int n_parts = parallel::chunks(m, 4);
+        parallel::for_each_task(n_parts, [&](int part, int)
+        {
+            int from = (int)((long long)m * part / n_parts), to = (int)((long long)m * (part + 1) / n_parts);
+            for (int j = from; j < to; ++j)
+                s[j] = of_item(picked[j], owner[j], neighbour(picked[j], owner[j]), clusters, dist);
+        });
+
+        // averages (summed in order, so they do not depend on the threads) and the variances of the estimates
+        double overall_variance = 0.0;
+        for (int c = 0; c < K; ++c)
+        {
+            int m_c = first[c + 1] - first[c];
+            if (m_c == 0)
+                continue;
+            double mean = 0.0;
+            for (int j = first[c]; j < first[c + 1]; ++j)
+                mean += s[j];
+            mean /= m_c;
+
+            double variance = 0.0; // variance of the mean of the sample
+            int n_c = clusters.size(c);
+            if (m_c > 1 && m_c < n_c)
+            {
+                for (int j = first[c]; j < first[c + 1]; ++j)
+                    variance += (s[j] - mean) * (s[j] - mean);
+                variance = variance / (m_c - 1) / m_c * (1.0 - (double)m_c / n_c);
+            }
+
+            double weight = (double)n_c / n;
+            report.cluster_average[c] = mean;
+            report.cluster_margin[c] = 1.96 * std::sqrt(variance);
+            report.average += weight * mean;
+            overall_variance += weight * weight * variance;
+        }
+        report.margin = 1.96 * std::sqrt(overall_variance);
+        report.evaluated = m;
+        return report;
+    }
+}
+
+#endif
@@ -9,6 +9,8 @@
 #include <cmath>
 #include <unordered_map>
 #include <algorithm>
+#include <limits>
+#include <random>
 
 using namespace std;
 
@@ -23,7 +25,6 @@ public:
     // int cluster2 = -1; // second nearest cluster
 
     bool null = false;    // flag if is NULL item created to initialize a pair vector for knn and brute foce algorithms
-    bool claimed = false; // will be used in reverse assignment to indicate if item has been claimed by a ball (in order to resolve conflicts)
     bool marked = false;  // will be used in reverse assignment to indicate item has been assigned to a cluster
 
     Item(string id, const vector<double> &xij) : id(id), xij(xij) { null = false; }
@@ -53,6 +54,34 @@ vector<string> tokenize(const string &str)
     return tokens;
 }
 
+// fills item with a line of a dataset/query file (an id followed by the values of the vector), returns false for an empty line
+bool parse_item(const string &line, Item &item, int line_count)
+{
+    vector<string> out;
+    out = tokenize(line);
+    if (out.empty())
+        return false;
+    item.id = out[0];
+    item.null = false;
+    item.xij.clear();
+
+    // Μετατροπή των values του διανύσματος από string σε double
+    for (size_t i = 1; i < out.size(); ++i)
+    {
+        try
+        {
+            double xij_int = stod(out[i]);
+            item.xij.push_back(xij_int);
+        }
+        catch (...)
+        {
+            cout << "[Line:" << line_count << "] Here is the catch: " << out[i] << "." << endl;
+            cout << "[Line:" << line_count << "] Type: " << typeid(out[i]).name() << endl;
+        }
+    }
+    return true;
+}
+
 // used to read our dataset/query files
 void read_items(vector<Item> *data, const string &filename)
 {
@@ -68,50 +97,80 @@ void read_items(vector<Item> *data, const string &filename)
         cout << "Error opening file " << filename << endl;
     }
 
-    int count = 1;
-    int catch_count = 0;
     int line_count = 1;
     while (!f.eof())
     {
         if (getline(f, line))
         {
             line_count++;
-            vector<string> out;
-            out = tokenize(line);
             Item item;
-            item.id = out[0];
-            item.null = false;
-
-            // Μετατροπή των values του διανύσματος από string σε double
-            for (size_t i = 1; i < out.size(); ++i)
-            {
-                try
-                {
-                    double xij_int = stod(out[i]);
-                    item.xij.push_back(xij_int);
-                }
-                catch (...)
-                {
-                    cout << "[Line:" << line_count << "] Here is the catch: " << out[i] << "." << endl;
-                    cout << "[Line:" << line_count << "] Type: " << typeid(out[i]).name() << endl;
-                    catch_count++;
-                }
-            }
-            data->push_back(item);
-            count += 1;
+            if (parse_item(line, item, line_count))
+                data->push_back(item);
         }
+    }
 
-        /*
+    f.close();
+    return;
+}
+
+// reads the items of a dataset file one at a time, so that a file that does not fit in memory can be passed over (again and again)
+class ItemStream
+{
+    ifstream f;
+    int line_count = 1;
+
+public:
+    ItemStream(const string &filename)
+    {
+        f.open(filename);
+        if (f.is_open())
+            cout << "File " << filename << " successfully opened (streaming)" << endl;
         else
+            cout << "Error opening file " << filename << endl;
+    }
+
+    bool is_open() const { return f.is_open(); }
+
+    // reads the next item of the file, returns false at the end of the file
+    bool next(Item &item)
+    {
+        string line;
+        while (getline(f, line))
         {
-            cout << "Failed to read file at line " << count << endl;
+            line_count++;
+            if (parse_item(line, item, line_count))
+                return true;
         }
-        */
+        return false;
     }
-    // cout << "Catches: " << catch_count << endl;
 
-    f.close();
-    return;
+    // back to the first item of the file
+    void rewind()
+    {
+        f.clear();
+        f.seekg(0);
+        line_count = 1;
+    }
+};
+
+// keeps a uniform random sample of (at most) s items of the stream in sample (reservoir sampling) and rewinds the stream
+void sample_items(ItemStream &stream, int s, vector<Item> *sample, std::default_random_engine &eng)
+{
+    Item item;
+    long long seen = 0;
+    while (stream.next(item))
+    {
+        seen++;
+        if (sample->size() < s)
+            sample->push_back(item);
+        else
+        {
+            long long j = std::uniform_int_distribution<long long>(0, seen - 1)(eng);
+            if (j < s)
+                (*sample)[j] = item;
+        }
+    }
+    stream.rewind();
 }
 
 // computes the Euclidean Distance between 2 Items of dimension d
@@ -155,18 +214,6 @@ int HammingDistance(unsigned int i1, unsigned int i2)
     return setBits;
 }
 
-// used to calculate mean for the update(maximization) step of Lloyd's algorithm
-// v1 works as an accumulator
-vector<double> vector_mean(vector<double> &v1, const vector<double> &v2, int dimensions, int T)
-{
-    vector<double> result(dimensions, 0);
-    for (int i = 0; i < dimensions; ++i)
-    {
-        result[i] = v1[i] + (v2[i] / T);
-    }
-    return result;
-}
-
 std::vector<std::pair<double, Item *>> brute_force_search(vector<Item> &dataset, Item *query, int N)
 {
     int dimension = dataset[0].xij.size();
@@ -14,42 +14,64 @@ int main(int argc, char *argv[])
                   << "Something went wrong while reading command line parameters." << std::endl
                   << "Please make sure you follow the format bellow: " << std::endl
                   << "./bin/cluster -i <input file> -c <configuration file> -o <output file> -update <Mean Frechet "
-                  << "or Mean Vector> -assignment <Classic or LSH or Hypercube or LSH_Frechet> "
-                  << "-complete <optional> -silhouette <optional>" << std::endl;
+                  << "or Mean Vector> -assignment <Classic or Accelerated or MiniBatch or LSH or Hypercube or LSH_Frechet> "
+                  << "-complete <optional> -silhouette <optional> -silhouette_sample <optional> -threads <optional> -stream <optional>" << std::endl;
         return -1;
     }
     params.print_NN_params();
+    parallel::set_threads(params.threads);
 
     // read the datasets as vector of Items (Item is described in utils.hpp)
     std::vector<Item> *dataset = new vector<Item>;
-    read_items(dataset, params.input_f);
+    ItemStream *stream = nullptr;
+    if (params.stream)
+    {
+        // MiniBatch reads its batches from the file, so we only keep a sample of it to initialize the centers
+        stream = new ItemStream(params.input_f);
+        std::default_random_engine eng(chrono::system_clock::now().time_since_epoch().count());
+        sample_items(*stream, std::max(params.batch_size, 10 * params.clusters), dataset, eng);
+    }
+    else
+        read_items(dataset, params.input_f);
 
-    clock_t begin;
-    clock_t end;
+    chrono::steady_clock::time_point begin;
+    chrono::steady_clock::time_point end;
 
     if (lc(params.update) == "mean vector")
     {
         vector_cluster::Clustering *c = new vector_cluster::Clustering(params, dataset);
         if(lc(params.assignment) == "classic")
         {
-            begin = clock();
+            begin = chrono::steady_clock::now();
             c->Classic_Clustering(20);
-            end = clock();
+            end = chrono::steady_clock::now();
+        }
+        else if(lc(params.assignment) == "accelerated")
+        {
+            begin = chrono::steady_clock::now();
+            c->Accelerated_Clustering(20);
+            end = chrono::steady_clock::now();
+        }
+        else if(lc(params.assignment) == "minibatch")
+        {
+            begin = chrono::steady_clock::now();
+            c->MiniBatch_Clustering(params.batch_size, params.max_passes, stream);
+            end = chrono::steady_clock::now();
         }
         else if(lc(params.assignment) == "lsh")
         {
-            begin = clock();
+            begin = chrono::steady_clock::now();
             c->Reverse_Assignment_LSH_Clustering(20);
-            end = clock();
+            end = chrono::steady_clock::now();
         }
         else if(lc(params.assignment) == "hypercube")
         {
-            begin = clock();
+            begin = chrono::steady_clock::now();
             c->Reverse_Assignment_HC_Clustering(20);
-            end = clock();
+            end = chrono::steady_clock::now();
         }    
 
-        double elapsed = double(end - begin) / CLOCKS_PER_SEC;
+        double elapsed = chrono::duration<double>(end - begin).count();
         ofstream output_file;
         output_file.open(params.output_f);
 
@@ -67,9 +89,9 @@ int main(int argc, char *argv[])
                 output_file << c->centers[i].xij[j] << ",";
             }
             output_file << "]";
-            for (int j = 0; j < c->clusters[i].size(); j++)
+            for (int j = 0; j < c->cluster_size(i); j++)
             {
-                output_file << ", " << c->clusters[i][j].id;
+                output_file << ", " << c->member_id(i, j);
             }
             output_file << "}" << endl;
         }
@@ -78,7 +100,7 @@ int main(int argc, char *argv[])
     {
         for (int i = 0; i < params.clusters; i++)
         {
-            output_file << "CLUSTER-" << i + 1 << " {size: " << c->clusters[i].size() << ", centroid: [";
+            output_file << "CLUSTER-" << i + 1 << " {size: " << c->cluster_size(i) << ", centroid: [";
             for (int j = 0; j < (*dataset)[0].xij.size(); j++)
             {
                 output_file << c->centers[i].xij[j] << ",";
@@ -91,9 +113,14 @@ int main(int argc, char *argv[])
     {
 
         cout << "[CALCULATING SILHOUETTE]" << endl;
-        if (c->centers.size() > 1)
+        if (params.stream)
+        {
+            cout << "Silhouette needs the whole dataset in memory, so it is not computed with -stream." << endl;
+        }
+        else if (c->centers.size() > 1)
         {
             output_file << "clustering_time: " << elapsed << endl;
+            c->evaluate_silhouette(params.silhouette_sample);
             output_file << "Silhouette: [";
             for (int i = 0; i < params.clusters; i++)
             {
@@ -101,6 +128,13 @@ int main(int argc, char *argv[])
                 output_file << c->eval_specific_cluster(i) << ", ";
             }
             output_file << c->eval_clustering() << "]" << endl;
+            if (c->silhouettes.evaluated < c->silhouettes.items) // estimated from a sample, so print the 95% margins as well
+            {
+                output_file << "Silhouette_margin (95%, " << c->silhouettes.evaluated << " of " << c->silhouettes.items << " items): [";
+                for (int i = 0; i < params.clusters; i++)
+                    output_file << c->silhouettes.cluster_margin[i] << ", ";
+                output_file << c->silhouettes.margin << "]" << endl;
+            }
         }
         else
         {
@@ -111,40 +145,49 @@ int main(int argc, char *argv[])
         output_file.close();
 
         delete c;
+        delete stream;
 
     }
     if (lc(params.update) == "mean frechet")
     {
-        // convert dataset to curves
-        vector<curves::Curve2d> *curves_dataset = new vector<curves::Curve2d>;
         // create a vector that will help us represent time
         vector<double> t_dimension;
         for (int i = 0; i < (*dataset)[0].xij.size(); i++)
         {
             t_dimension.push_back(i);
         }
-        // create a dataset of curves using our original dataset and the time vector
-        for (int i = 0; i < 100; i++)
+        // convert dataset to curves, stored packed and sharing the time vector
+        curves::CurveDataset *curves_store = new curves::CurveDataset(t_dimension);
+        curves_store->reserve(dataset->size(), t_dimension.size());
+        for (int i = 0; i < dataset->size(); i++)
         {
-            curves_dataset->push_back(curves::Curve2d((*dataset)[i].id, t_dimension, (*dataset)[i].xij));
+            if (!curves_store->add((*dataset)[i].id, (*dataset)[i].xij))
+                return -1; // the curves are indexed like the items, so none can be missing
         }
+        vector<curves::Curve2d> *curves_dataset = new vector<curves::Curve2d>(curves_store->curves());
 
         curve_cluster::Clustering *c = new curve_cluster::Clustering(params, curves_dataset);
 
         if(lc(params.assignment) == "classic")
         {
-            begin = clock();
+            begin = chrono::steady_clock::now();
             c->Classic_Clustering(20);
-            end = clock();
+            end = chrono::steady_clock::now();
+        }
+        else if(lc(params.assignment) == "accelerated")
+        {
+            begin = chrono::steady_clock::now();
+            c->Accelerated_Clustering(20);
+            end = chrono::steady_clock::now();
         }
         else if(lc(params.assignment) == "lsh_frechet")
         {
-            begin = clock();
+            begin = chrono::steady_clock::now();
             c->Reverse_Assignment_LSH_Clustering(20);
-            end = clock();
+            end = chrono::steady_clock::now();
         }
 
-        double elapsed = double(end - begin) / CLOCKS_PER_SEC;
+        double elapsed = chrono::duration<double>(end - begin).count();
         ofstream output_file;
         output_file.open(params.output_f);
 
@@ -163,9 +206,9 @@ int main(int argc, char *argv[])
                     output_file << ", (" << c->centers[i][j].x << "," << c->centers[i][j].y << ")";
                 }
                 output_file << "]";
-                for (int j = 0; j < c->clusters[i].size(); j++)
+                for (int j = 0; j < c->clusters.size(i); j++)
                 {
-                    output_file << ", " << c->clusters[i][j].id;
+                    output_file << ", " << (*curves_dataset)[c->clusters(i, j)].id;
                 }
                 output_file << "}" << endl;
             }
@@ -174,7 +217,7 @@ int main(int argc, char *argv[])
         {
             for (int i = 0; i < params.clusters; i++)
             {
-                output_file << "CLUSTER-" << i + 1 << " {size: " << c->clusters[i].size() << ", centroid: [";
+                output_file << "CLUSTER-" << i + 1 << " {size: " << c->clusters.size(i) << ", centroid: [";
                 output_file << "(" << c->centers[i][0].x << "," << c->centers[i][0].y << ")";
                 for (int j = 1; j <  c->centers[i].size(); j++)
                 {
@@ -186,10 +229,11 @@ int main(int argc, char *argv[])
 
         if (params.silhouette == true)
         {
-            cout << "[CALCULATING SILHOUETTE] (This step takes a couple of minutes)" << endl;
+            cout << "[CALCULATING SILHOUETTE]" << endl;
             if (params.clusters > 1)
             {
                 output_file << "clustering_time: " << elapsed << endl;
+                c->evaluate_silhouette(params.silhouette_sample);
                 output_file << "Silhouette: [";
                 for (int i = 0; i < params.clusters; i++)
                 {
@@ -197,6 +241,13 @@ int main(int argc, char *argv[])
                     output_file << c->eval_specific_cluster(i) << ", ";
                 }
                 output_file << c->eval_clustering() << "]" << endl;
+                if (c->silhouettes.evaluated < c->silhouettes.items) // estimated from a sample, so print the 95% margins as well
+                {
+                    output_file << "Silhouette_margin (95%, " << c->silhouettes.evaluated << " of " << c->silhouettes.items << " items): [";
+                    for (int i = 0; i < params.clusters; i++)
+                        output_file << c->silhouettes.cluster_margin[i] << ", ";
+                    output_file << c->silhouettes.margin << "]" << endl;
+                }
             }
             else
             {
@@ -207,6 +258,8 @@ int main(int argc, char *argv[])
         output_file.close();
 
         delete c;
+        delete curves_dataset;
+        delete curves_store;
     }
 
     return 0;
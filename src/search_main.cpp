@@ -4,6 +4,7 @@
 #include "../ui/NN_interface.hpp"
 #include "../includes/curves.hpp"
 #include "../includes/mean_curve.hpp"
+#include "../includes/parallel.hpp"
 #include "../TimeSeries-ANN/L2/LSH.hpp"
 #include "../TimeSeries-ANN/L2/HC.hpp"
 #include "../TimeSeries-ANN/DiscreteFrechet/discF_LSH.hpp"
@@ -20,10 +21,14 @@ int main(int argc, char *argv[])
                   << "Please make sure you follow the format bellow: " << std::endl
                   << "./bin/search -i <input file> -q <query file> -k <int> -L <int> -M <int> -probes "
                   << "<int> -o <output file> -algorithm <LSH or Hypercube or Frechet> -metric <discrete "
-                  << "or continuous | only for -algorithm Frechet> -delta <double>" << std::endl;
+                  << "or continuous | only for -algorithm Frechet> -delta <double> -querying_trick <true or false> "
+                  << "-threads <int>" << std::endl;
         return -1;
     }
     params.print_NN_params();
+    parallel::set_threads(params.threads);
+    Config::number_threads = parallel::threads(); // same number of threads for the continuous Frechet computations
+    Config::apply();
 
     // read the datasets as vector of Items (Item is described in utils.hpp)
     vector<Item> *dataset = new vector<Item>;
@@ -203,9 +208,6 @@ int main(int argc, char *argv[])
     {
         std::cout << "------[" << params.metric << " Frechet]------" << std::endl;
 
-        vector<curves::Curve2d> *curves_dataset = new vector<curves::Curve2d>;
-        vector<curves::Curve2d> *curves_queryset = new vector<curves::Curve2d>;
-
         // create a vector that will help us represent time
         vector<double> t_dimension;
         for (int i = 0; i < (*dataset)[0].xij.size(); i++)
@@ -213,28 +215,37 @@ int main(int argc, char *argv[])
             t_dimension.push_back(i);
         }
 
-        // create a dataset of curves using our original dataset and the time vector
-        for (int i = 0; i < 100; i++)
+        // store the curves of our original dataset and of the query set packed, sharing the time vector
+        curves::CurveDataset *dataset_store = new curves::CurveDataset(t_dimension);
+        curves::CurveDataset *queryset_store = new curves::CurveDataset(t_dimension);
+        dataset_store->reserve(dataset->size(), t_dimension.size());
+        queryset_store->reserve(queries->size(), t_dimension.size());
+        for (int i = 0; i < dataset->size(); i++)
         {
-            curves_dataset->push_back(curves::Curve2d((*dataset)[i].id, t_dimension, (*dataset)[i].xij));
+            if (!dataset_store->add((*dataset)[i].id, (*dataset)[i].xij))
+                return -1; // the curves are indexed like the items, so none can be missing
         }
-
-        // do the same for query set
         for (int i = 0; i < (*queries).size(); i++)
         {
-            curves_queryset->push_back(curves::Curve2d((*queries)[i].id, t_dimension, (*queries)[i].xij));
+            if (!queryset_store->add((*queries)[i].id, (*queries)[i].xij))
+                return -1;
         }
+        // the packed curves replace the original vectors from here on
+        vector<Item>().swap(*dataset);
+
+        vector<curves::Curve2d> *curves_dataset = new vector<curves::Curve2d>(dataset_store->curves());
+        vector<curves::Curve2d> *curves_queryset = new vector<curves::Curve2d>(queryset_store->curves());
 
         if(params.delta == 0.0) // if delta is not defined by user or if it is 0.0, auto tune it according to dataset
         {
             params.delta = delta_tuning(*curves_dataset);
         }
 
-        if (lc(params.metric) == "discrete") // L = 6, delta = avg dist between curve vertices, tablesize = dataset_size/8, threshold = dataset_size/4, querying trick = false
+        if (lc(params.metric) == "discrete") // L = 6, delta = avg dist between curve vertices, tablesize = dataset_size/8, threshold = dataset_size/4, querying trick = false (default)
         {
             // perform LSH for discrete Frechet
 
-            dFLSH::LSH *dLSH = new dFLSH::LSH(curves_dataset, params.L, params.delta, 8);
+            dFLSH::LSH *dLSH = new dFLSH::LSH(curves_dataset, params.L, params.delta, 8, params.querying_trick);
 
             std::cout << "Searching for the approximate nearest neighbors of the query curves..." << std::endl;
             ofstream output_file;
@@ -248,7 +259,7 @@ int main(int argc, char *argv[])
 
                 // cout << "[ANN]" << endl;
                 lsh_begin = std::chrono::steady_clock::now();
-                std::pair<curves::Curve2d *, double> ann = dLSH->search_ANN((*curves_queryset)[i], false, curves_dataset->size() / 4);
+                std::pair<curves::Curve2d *, double> ann = dLSH->search_ANN((*curves_queryset)[i], params.querying_trick, curves_dataset->size() / 4);
                 lsh_elapsed += (double)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - lsh_begin).count() / 1000000.0);
 
                 // cout << "[Brute Force]" << endl;
@@ -292,11 +303,14 @@ int main(int argc, char *argv[])
         }
         else if (lc(params.metric) == "continuous")
         {
-            cF::filter_curves(*curves_dataset, 2*params.delta);
-            cF::filter_curves(*curves_queryset, 2*params.delta);
+            cF::filter_curves(*dataset_store, 2*params.delta);
+            cF::filter_curves(*queryset_store, 2*params.delta);
+            *curves_dataset = dataset_store->curves();
+            *curves_queryset = queryset_store->curves();
 
             // perform LSH for continuous Frechet
-            cFLSH::LSH *cLSH = new cFLSH::LSH(curves_dataset, 1, params.delta, 4);
+            cFLSH::LSH *cLSH = new cFLSH::LSH(curves_dataset, 1, params.delta, 4, params.querying_trick);
+            cF::PlanarCache planar_dataset(*curves_dataset); // for the exact searches
 
             std::cout << "Searching for the approximate nearest neighbors of the query curves..." << std::endl;
             ofstream output_file;
@@ -310,12 +324,12 @@ int main(int argc, char *argv[])
 
                 // cout << "[ANN]" << endl;
                 lsh_begin = std::chrono::steady_clock::now();
-                std::pair<curves::Curve2d *, double> ann = cLSH->search_ANN((*curves_queryset)[i], true, curves_dataset->size() / 4);
+                std::pair<curves::Curve2d *, double> ann = cLSH->search_ANN((*curves_queryset)[i], params.querying_trick, curves_dataset->size() / 4);
                 lsh_elapsed += (double)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - lsh_begin).count() / 1000000.0);
 
                 // cout << "[Brute Force]" << endl;
                 true_begin = std::chrono::steady_clock::now();
-                std::pair<curves::Curve2d *, double> true_nn = cF::search_exactNN((*curves_queryset)[i], *curves_dataset);
+                std::pair<curves::Curve2d *, double> true_nn = cF::search_exactNN((*curves_queryset)[i], *curves_dataset, planar_dataset);
                 brute_elapsed += (double)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - true_begin).count() / 1000000.0);
 
                 int neighboors_returned = 0;
@@ -347,6 +361,7 @@ int main(int argc, char *argv[])
             cout << "[EVALUATION]" << endl;
             cout << "tcF_LSH/tTrue: " << lsh_elapsed / brute_elapsed << endl;
             cout << "distcF_LSH/distTrue (avg): " << error / (double)curves_queryset->size() << endl;
+            cout << Frechet::Continuous::bound_statistics.repr() << endl; // how many candidates the cheap lower bounds got rid of
 
             output_file.close();
 
@@ -355,6 +370,8 @@ int main(int argc, char *argv[])
 
         delete curves_dataset;
         delete curves_queryset;
+        delete dataset_store;
+        delete queryset_store;
     }
 
     delete dataset;
@@ -23,6 +23,9 @@ namespace Cli
             {"-assignment", "none"},
             {"-complete", "none"},
             {"-silhouette", "none"},
+            {"-silhouette_sample", "none"},
+            {"-threads", "none"},
+            {"-stream", "none"},
         };
         std::map<std::string, std::string>::iterator it;  // map iterator
         std::map<std::string, std::string>::iterator it2; // map iterator 2
@@ -51,6 +54,31 @@ namespace Cli
                     return 3;
                 if (num == 6)
                     return 2;
+                if (num == 7)
+                    return 100;
+                if (num == 8)
+                    return 256;
+                if (num == 9)
+                    return 10;
+                if (num == 10)
+                    return 0;
+
+                return -2;
+            }
+        }
+
+        double try_stod(std::string param, int num)
+        {
+            try
+            {
+                double val = stod(param);
+                return val;
+            }
+            catch (...)
+            {
+                std::cout << "[Configuration ERROR] Given value " << param << " in configuration file cannot be converted to double." << std::endl;
+                if (num == 11)
+                    return 0.5;
 
                 return -2;
             }
@@ -68,7 +96,7 @@ namespace Cli
                 if (it->second == "none")
                 {
                     // handle optional
-                    if ((curr_key != "-complete") && (curr_key != "-silhouette"))
+                    if ((curr_key != "-complete") && (curr_key != "-silhouette") && (curr_key != "-silhouette_sample") && (curr_key != "-threads") && (curr_key != "-stream"))
                     {
                         std::cout << "[INPUT ERROR] Could not find value for mandatory parameter " << curr_key << ". If you entered this parameter then make sure you didn't forget anything before that." << std::endl;
                         return -1;
@@ -94,9 +122,9 @@ namespace Cli
                 {
                     this->assignment = this->param_set.find("-assignment")->second;
                     std::string lc_assignment = lc(this->assignment);
-                    if ((lc_assignment != "classic") && (lc_assignment != "lsh") && (lc_assignment != "hypercube") && (lc_assignment != "lsh_frechet"))
+                    if ((lc_assignment != "classic") && (lc_assignment != "accelerated") && (lc_assignment != "minibatch") && (lc_assignment != "lsh") && (lc_assignment != "hypercube") && (lc_assignment != "lsh_frechet"))
                     {
-                        std::cout << "Value " << this->assignment << " is not acceptable for parameter -assignment. Please enter Classic or LSH or Hypercube or LSH_Frechet." << std::endl;
+                        std::cout << "Value " << this->assignment << " is not acceptable for parameter -assignment. Please enter Classic or Accelerated or MiniBatch or LSH or Hypercube or LSH_Frechet." << std::endl;
                         return -1;
                     }
                 }
@@ -114,27 +142,72 @@ namespace Cli
                     else
                         this->silhouette = false;
                 }
-                it++;
-
-                // finally, confirm that given -assignment and -update are compatible
-                if (lc(this->update) == "mean vector")
+                if (curr_key == "-silhouette_sample")
                 {
-                    if (lc(this->assignment) == "lsh_frechet")
+                    this->silhouette_sample = 0;
+                    if (it->second != "none")
                     {
-                        std::cout << "Mean Vector assignment method is not compatible with LSH_Frechet assignment method." << std::endl
-                                  << "Please pick an assignment method between Classic, LSH and Hypercube." << std::endl;
-                        return -1;
+                        try
+                        {
+                            this->silhouette_sample = stoi(it->second);
+                        }
+                        catch (...)
+                        {
+                            std::cout << "Value " << it->second << " is not acceptable for parameter -silhouette_sample. Please enter an integer." << std::endl;
+                            return -1;
+                        }
+                        this->silhouette = true; // a sample size asks for the silhouette as well
                     }
                 }
-                if (lc(this->update) == "mean frechet")
+                if (curr_key == "-stream")
                 {
-                    if ((lc(this->assignment) == "lsh") || (lc(this->assignment) == "hypercube"))
+                    if (this->param_set.find("-stream")->second != "none")
+                        this->stream = true;
+                    else
+                        this->stream = false;
+                }
+                if (curr_key == "-threads")
+                {
+                    this->threads = 0;
+                    if (it->second != "none")
                     {
-                        std::cout << "Mean Frechet assignment method is not compatible with neither LSH nor Hypercube assignment methods." << std::endl
-                                  << "Please pick an assignment method between Classic and LSH_Frechet." << std::endl;
-                        return -1;
+                        try
+                        {
+                            this->threads = stoi(it->second);
+                        }
+                        catch (...)
+                        {
+                            std::cout << "Value " << it->second << " is not acceptable for parameter -threads. Please enter an integer." << std::endl;
+                            return -1;
+                        }
                     }
                 }
+                it++;
+            }
+
+            // finally, confirm that given -assignment and -update are compatible
+            if (lc(this->update) == "mean vector")
+            {
+                if (lc(this->assignment) == "lsh_frechet")
+                {
+                    std::cout << "Mean Vector assignment method is not compatible with LSH_Frechet assignment method." << std::endl
+                              << "Please pick an assignment method between Classic, Accelerated, MiniBatch, LSH and Hypercube." << std::endl;
+                    return -1;
+                }
+            }
+            if (this->stream && lc(this->assignment) != "minibatch")
+            {
+                std::cout << "-stream can only be used with the MiniBatch assignment method." << std::endl;
+                return -1;
+            }
+            if (lc(this->update) == "mean frechet")
+            {
+                if ((lc(this->assignment) == "lsh") || (lc(this->assignment) == "hypercube") || (lc(this->assignment) == "minibatch"))
+                {
+                    std::cout << "Mean Frechet assignment method is not compatible with LSH, Hypercube or MiniBatch assignment methods." << std::endl
+                              << "Please pick an assignment method between Classic, Accelerated and LSH_Frechet." << std::endl;
+                    return -1;
+                }
             }
             return 0;
         }
@@ -176,6 +249,16 @@ namespace Cli
                         this->d = this->try_stoi(out[1], 5);
                     if (line_count == 6)
                         this->probes = this->try_stoi(out[1], 6);
+                    if (line_count == 7)
+                        this->max_center_complexity = this->try_stoi(out[1], 7);
+                    if (line_count == 8)
+                        this->batch_size = this->try_stoi(out[1], 8);
+                    if (line_count == 9)
+                        this->max_passes = this->try_stoi(out[1], 9);
+                    if (line_count == 10)
+                        this->seeding_rounds = this->try_stoi(out[1], 10);
+                    if (line_count == 11)
+                        this->oversampling = this->try_stod(out[1], 11);
                 }
             }
             // check if something went wrong with mandatory parameter K of K-medians
@@ -198,11 +281,19 @@ namespace Cli
         int M;                  // max number of vectors to be checked for HC
         int d;                  // number of dimensions on which to project for HC
         int probes;             // max number of probes to be checked for HC
+        int max_center_complexity = 100; // max number of vertices of a Mean Frechet center (0 for no limit), optional 7th line of the configuration file
+        int batch_size = 256;   // number of vectors in each batch of MiniBatch, optional 8th line of the configuration file
+        int max_passes = 10;    // max number of passes of MiniBatch over the dataset, optional 9th line of the configuration file
+        int seeding_rounds = 0; // rounds of k-means|| when picking the initial centers (0 for k-means++), optional 10th line of the configuration file
+        double oversampling = 0.5; // candidates sampled by each round of k-means|| per center, optional 11th line of the configuration file
         std::string output_f;   // ouput file
         std::string update;     // method used for the update step
         std::string assignment; // method used for the assignment step
-        bool complete;          // if given, prints clusters in detail in the output
-        bool silhouette;        // if given, prints silhouette in the output
+        bool complete = false;  // if given, prints clusters in detail in the output
+        bool silhouette = false; // if given, prints silhouette in the output
+        int silhouette_sample = 0; // if positive, silhouette is estimated from about this many items (0 means all of them)
+        int threads = 0;        // number of threads to be used (0 means all cores of the machine)
+        bool stream = false;    // if given, MiniBatch reads its batches from the input file instead of loading the whole dataset
         bool success = true;    // to check if construction of object was 100% successful
 
         // Constructor
@@ -214,9 +305,11 @@ namespace Cli
                 this->conf_f = "cluster.conf";
                 this->output_f = "output.txt";
                 this->update = "Mean vector"; // Mean Frechet - Mean Vector
-                this->assignment = "Classic"; // Classic - LSH - Hypercube - LSH_Frechet
+                this->assignment = "Classic"; // Classic - Accelerated - MiniBatch - LSH - Hypercube - LSH_Frechet
                 this->complete = false;
                 this->silhouette = false;
+                this->threads = 0;
+                this->stream = false;
                 if (this->read_config() == -1) // read the configuration file
                 {
                     this->success = false;
@@ -245,7 +338,7 @@ namespace Cli
                     else // if found pass the corresponding value to the map
                     {
                         // handle optional parameters
-                        if ((this->it->first == "-complete") || (this->it->first == "-silhouette"))
+                        if ((this->it->first == "-complete") || (this->it->first == "-silhouette") || (this->it->first == "-stream"))
                         {
                             this->it->second = "true";
                         }
@@ -300,10 +393,18 @@ namespace Cli
                       << "M: " << this->M << std::endl
                       << "d': " << this->d << std::endl
                       << "probes: " << this->probes << std::endl
+                      << "max center complexity: " << this->max_center_complexity << std::endl
+                      << "batch size: " << this->batch_size << std::endl
+                      << "max passes: " << this->max_passes << std::endl
+                      << "seeding rounds: " << this->seeding_rounds << std::endl
+                      << "oversampling: " << this->oversampling << std::endl
                       << "Update: " << this->update << std::endl
                       << "Assignment: " << this->assignment << std::endl
                       << "Complete: " << this->complete << std::endl
                       << "Silhouette: " << this->silhouette << std::endl
+                      << "Silhouette sample: " << this->silhouette_sample << std::endl
+                      << "Threads: " << this->threads << std::endl
+                      << "Stream: " << this->stream << std::endl
                       << "-------------------------------------------" << std::endl;
         }
     };
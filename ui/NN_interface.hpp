@@ -24,7 +24,9 @@ namespace NNi
             {"-o", "none"},
             {"-algorithm", "none"},
             {"-metric", "none"},
-            {"-delta", "none"}};
+            {"-delta", "none"},
+            {"-querying_trick", "none"},
+            {"-threads", "none"}};
         std::map<std::string, std::string>::iterator it; // map iterator
 
         /* Makes sure the value of a given parameter can be converted to int and sets it.
@@ -42,6 +44,8 @@ namespace NNi
                     this->M = val;
                 else if (param == "-probes")
                     this->probes = val;
+                else if (param == "-threads")
+                    this->threads = val;
             }
             catch (...)
             {
@@ -67,6 +71,26 @@ namespace NNi
             }
         }
 
+        /* Makes sure the value of a given parameter is a yes/no answer and sets it.
+            On a failure it resets the value to "none". */
+        void try_stob(std::string param)
+        {
+            std::string val = lc(this->param_set.find(param)->second);
+            bool result;
+            if ((val == "true") || (val == "on") || (val == "yes") || (val == "1"))
+                result = true;
+            else if ((val == "false") || (val == "off") || (val == "no") || (val == "0"))
+                result = false;
+            else
+            {
+                std::cout << "[INPUT ERROR] Given value " << this->param_set.find(param)->second << " of parameter " << param << " cannot be converted to true/false." << std::endl;
+                this->param_set.find(param)->second = "none";
+                return;
+            }
+            if (param == "-querying_trick")
+                this->querying_trick = result;
+        }
+
         /* Sets default value to corresponding command line parameter.
             Default value of parameter k changes according to algorithm.
             Prints error message on failure. */
@@ -105,6 +129,18 @@ namespace NNi
             	this->delta = 0.0;
             	this->param_set.find(param)->second = "0.0";
             }
+            else if (param == "-threads")
+            {
+                // 0 stands for "as many as the cores of the machine"
+                this->threads = 0;
+                this->param_set.find(param)->second = "0";
+            }
+            else if (param == "-querying_trick")
+            {
+                // on by default only for continuous Frechet, where skipping the metric pays off
+                this->querying_trick = (lc(this->metric) == "continuous");
+                this->param_set.find(param)->second = this->querying_trick ? "true" : "false";
+            }
             else
             {
                 std::cout << "Parameter " << param << " has no default value." << std::endl;
@@ -152,7 +188,7 @@ namespace NNi
                 // if a parameter has no value see if it can be set to a default
                 if (it->second == "none")
                 {
-                    if ((curr_key == "-k") || (curr_key == "-L") || (curr_key == "-M") || (curr_key == "-probes") || (curr_key == "-delta"))
+                    if ((curr_key == "-k") || (curr_key == "-L") || (curr_key == "-M") || (curr_key == "-probes") || (curr_key == "-delta") || (curr_key == "-querying_trick") || (curr_key == "-threads"))
                     {
                         this->set_default(curr_key, algo_lc);
                         std::cout << "Parameter " << curr_key << " has been set to default value." << std::endl;
@@ -186,6 +222,10 @@ namespace NNi
                         this->try_stoi("-probes");
                     else if (curr_key == "-delta")
                         this->try_stod("-delta");
+                    else if (curr_key == "-querying_trick")
+                        this->try_stob("-querying_trick");
+                    else if (curr_key == "-threads")
+                        this->try_stoi("-threads");
                     else if (curr_key == "-i")
                         this->input_f = this->param_set.find("-i")->second;
                     else if (curr_key == "-q")
@@ -204,7 +244,7 @@ namespace NNi
                 // if a parameter has no value see if it can be set to a default
                 if (it->second == "none")
                 {
-                    if ((curr_key == "-k") || (curr_key == "-L") || (curr_key == "-M") || (curr_key == "-probes") || (curr_key == "-delta"))
+                    if ((curr_key == "-k") || (curr_key == "-L") || (curr_key == "-M") || (curr_key == "-probes") || (curr_key == "-delta") || (curr_key == "-querying_trick") || (curr_key == "-threads"))
                     {
                         this->set_default(curr_key, algo_lc);
                         std::cout << "Parameter " << curr_key << " has been set to default value." << std::endl;
@@ -241,6 +281,8 @@ namespace NNi
         std::string algorithm; // algorithm to be used for this run
         std::string metric;    // metric to be used for this run (only for -algorithm Frechet)
         double delta;          // delta parameter for LSH of curves
+        bool querying_trick;   // if true, Frechet LSH first looks for dataset curves with the same grid-curve as the query
+        int threads;           // number of threads to be used (0 for all cores)
         bool success = true;   // to check if construction of object was 100% successful
 
         // Constructor
@@ -258,6 +300,8 @@ namespace NNi
                 this->algorithm = "Frechet"; // LSH - Hypercube - Frechet
                 this->metric = "continuous";       // discrete - continuous
                 this->delta = 0.0;
+                this->querying_trick = true;
+                this->threads = 0;
             }
             else if (argc % 2 == 1) // normal run
             {
@@ -304,6 +348,8 @@ namespace NNi
                       << "M: " << this->M << std::endl
                       << "probes: " << this->probes << std::endl
                       << "delta: " << this->delta << std::endl
+                      << "querying trick: " << (this->querying_trick ? "on" : "off") << std::endl
+                      << "threads: " << this->threads << std::endl
                       << "-------------------------------------------" << std::endl;
         }
     };